@@ -41,4 +41,12 @@ void set_invisible(bool enabled);
  */
 void set_tab_completions(bool enabled);
 
+/**
+ * @brief Sets if standard input is raw, handing over keys as they're pressed without echoing or
+ *        editing them, or cooked into lines.
+ * @param raw if input should be raw.
+ * @param nonblocking if raw reads should return at once when no key has been pressed.
+ */
+void set_raw_input(bool raw, bool nonblocking);
+
 #endif //F_R_I_D_A_Y_CLI_H
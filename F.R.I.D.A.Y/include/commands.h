@@ -151,4 +151,58 @@ bool cmd_alarm(const char *comm);
   * @return true if it was handled, false if not.
   */
  bool cmd_minesweeper(const char *comm);
+ /**
+  * @brief The uptime command, shows the time since boot and the CPU utilisation.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_uptime(const char *comm);
+ /**
+  * @brief The 'sysbench' command, times null system requests through each kernel entry.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_sysbench(const char *comm);
+ /**
+  * @brief The 'top' command, shows live accounting for every process.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_top(const char *comm);
+ /**
+  * @brief Handles the 'sched' command, showing or changing the scheduling policy.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_sched(const char *comm);
+ /**
+  * @brief Handles the 'irqstat' command, showing or changing the interrupt controller.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_irqstat(const char *comm);
+ /**
+  * @brief Handles the 'strbench' command, timing each string function implementation.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_strbench(const char *comm);
+ /**
+  * @brief Handles the 'uart' command, showing or changing how COM1 transmits.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_uart(const char *comm);
+ /**
+  * @brief Handles the 'serial' command, showing, changing or benchmarking the serial ports' line settings.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_serial(const char *comm);
+ /**
+  * @brief Handles the devstat command, showing the serial ports' traffic counters.
+  * @param comm the command string.
+  * @return true if it was handled, false if not.
+  */
+ bool cmd_devstat(const char *comm);
 #endif //F_R_I_D_A_Y_COMMANDS_H
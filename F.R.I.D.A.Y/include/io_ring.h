@@ -0,0 +1,105 @@
+#ifndef F_R_I_D_A_Y_IO_RING_H
+#define F_R_I_D_A_Y_IO_RING_H
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "sync.h"
+#include "sys_req.h"
+#include "mpx/device.h"
+
+/**
+ * @file io_ring.h
+ * @brief Contains batched asynchronous IO through a submission and completion ring shared
+ * between a process and the kernel. The process queues any amount of READ and WRITE entries
+ * and submits them with a single request, or lets the kernel pick them up while scheduling,
+ * then harvests the completions without blocking.
+ */
+
+///The amount of entries in each ring, must be a power of 2.
+#define IO_RING_ENTRIES 16
+
+///A submitted IO operation.
+typedef struct {
+    ///Either READ or WRITE.
+    op_code operation;
+    ///The device to use.
+    device dev;
+    ///The buffer, which must stay valid until the operation completes.
+    char *buffer;
+    ///The amount of bytes to transfer.
+    size_t length;
+    ///A value passed back with the completion.
+    int user_data;
+} io_sqe_t;
+
+///A completed IO operation.
+typedef struct {
+    ///The value given in the submission.
+    int user_data;
+    ///The amount of bytes transferred, or negative on error.
+    int result;
+} io_cqe_t;
+
+///A submission and completion ring.
+typedef struct io_ring {
+    ///The submission entries, written by the process.
+    io_sqe_t sq[IO_RING_ENTRIES];
+    ///The completion entries, written by the kernel.
+    io_cqe_t cq[IO_RING_ENTRIES];
+    ///The next submission the kernel will take, only changed by the kernel.
+    volatile unsigned int sq_head;
+    ///The next free submission entry, only changed by the process.
+    volatile unsigned int sq_tail;
+    ///The next completion the process will take, only changed by the process.
+    volatile unsigned int cq_head;
+    ///The next free completion entry, only changed by the kernel.
+    volatile unsigned int cq_tail;
+    ///The amount of submissions taken by the kernel that haven't completed, kernel only.
+    unsigned int in_flight;
+    ///The amount of completions the owner is waiting for, kernel only.
+    unsigned int wanted;
+    ///The process owning the ring, kernel only.
+    struct pcb *owner;
+    ///The owner while it waits for completions, kernel only.
+    wait_queue_t waiters;
+    ///The next registered ring, kernel only.
+    struct io_ring *next;
+} io_ring_t;
+
+/**
+ * @brief Registers the ring with the kernel as this process's ring, resetting it.
+ * @param ring the ring.
+ * @return 0 on success, negative on error.
+ */
+int io_ring_setup(io_ring_t *ring);
+
+/**
+ * @brief Queues an operation in the submission ring. The kernel takes it on the next
+ *        @code io_ring_enter, or the next time it schedules a process.
+ * @param ring the ring.
+ * @param operation either READ or WRITE.
+ * @param dev the device.
+ * @param buffer the buffer, which must stay valid until the operation completes.
+ * @param length the amount of bytes to transfer.
+ * @param user_data a value passed back with the completion.
+ * @return true if it was queued, false if the submission ring is full.
+ */
+bool io_ring_queue(io_ring_t *ring, op_code operation, device dev, char *buffer, size_t length, int user_data);
+
+/**
+ * @brief Submits every queued operation with a single request.
+ * @param ring the ring.
+ * @param min_complete the amount of completions to wait for, 0 to not wait.
+ * @return the amount of operations submitted, or negative on error.
+ */
+int io_ring_enter(io_ring_t *ring, unsigned int min_complete);
+
+/**
+ * @brief Takes the oldest completion, without blocking.
+ * @param ring the ring.
+ * @param cqe where the completion is stored.
+ * @return true if there was a completion, false if not.
+ */
+bool io_ring_peek(io_ring_t *ring, io_cqe_t *cqe);
+
+#endif //F_R_I_D_A_Y_IO_RING_H
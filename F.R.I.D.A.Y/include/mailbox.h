@@ -0,0 +1,82 @@
+#ifndef F_R_I_D_A_Y_MAILBOX_H
+#define F_R_I_D_A_Y_MAILBOX_H
+
+#include "stddef.h"
+#include "sync.h"
+
+/**
+ * @file mailbox.h
+ * @brief Contains message passing between processes. Every process has a mailbox, and a message
+ * is a single heap block whose ownership moves from the sender to the receiver, so sending
+ * never copies the payload.
+ */
+
+///The longest sender name kept in a message, the same as PCB_MAX_NAME_LEN.
+#define MESSAGE_SENDER_LEN 8
+
+///A message, allocated with msg_alloc and freed by whoever owns it last.
+typedef struct message {
+    ///Used by the kernel to queue the message in a mailbox.
+    struct message *next;
+    ///The name of the sending process, filled in by the kernel.
+    char sender[MESSAGE_SENDER_LEN + 1];
+    ///The length of the data.
+    size_t length;
+    ///The data itself, stored directly after the message.
+    char data[];
+} message_t;
+
+///The messages sent to a process that it hasn't received yet.
+typedef struct mailbox {
+    ///The oldest message, received first.
+    message_t *head;
+    ///The newest message.
+    message_t *tail;
+    ///The owning process while it waits for a message.
+    wait_queue_t receivers;
+} mailbox_t;
+
+/**
+ * @brief Allocates a message with room for the given amount of data.
+ * @param length the length of the data.
+ * @return the message, or NULL if it couldn't be allocated.
+ */
+message_t *msg_alloc(size_t length);
+
+/**
+ * @brief Frees a received message, or one that couldn't be sent.
+ * @param msg the message.
+ */
+void msg_free(message_t *msg);
+
+/**
+ * @brief Sends the message to the named process. On success the message belongs to the receiver
+ *        and must not be touched again.
+ * @param to the name of the receiving process.
+ * @param msg the message, from msg_alloc.
+ * @return 0 on success, negative if the process doesn't exist.
+ */
+int msg_send(const char *to, message_t *msg);
+
+/**
+ * @brief Copies the data into a new message and sends it, meant for small messages.
+ * @param to the name of the receiving process.
+ * @param data the data.
+ * @param length the length of the data.
+ * @return 0 on success, negative on error.
+ */
+int msg_send_copy(const char *to, const void *data, size_t length);
+
+/**
+ * @brief Receives the oldest message in this process's mailbox, parking until one arrives.
+ * @return the message, which the caller must free with msg_free.
+ */
+message_t *msg_receive(void);
+
+/**
+ * @brief Receives the oldest message in this process's mailbox, without waiting.
+ * @return the message, which the caller must free with msg_free, or NULL if the mailbox is empty.
+ */
+message_t *msg_try_receive(void);
+
+#endif //F_R_I_D_A_Y_MAILBOX_H
@@ -35,6 +35,16 @@ unsigned int ui_realmod(int x, int mod);
 */
 double pow(double a, double b);
 
+/**
+ * @brief Calculates part / whole, scaled by the given scale (i.e. 100 for a percentage).
+ *        64 bit division isn't available, so both values are shifted down until they fit in 32 bits.
+ * @param part the part.
+ * @param whole the whole, if 0 then 0 is returned.
+ * @param scale the scale of the result.
+ * @return the scaled ratio.
+ */
+unsigned int scale_ratio(unsigned long long part, unsigned long long whole, unsigned int scale);
+
 /**
  * @brief Gets the current seed for the random.
  *
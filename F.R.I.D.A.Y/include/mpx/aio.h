@@ -0,0 +1,43 @@
+#ifndef F_R_I_D_A_Y_AIO_H
+#define F_R_I_D_A_Y_AIO_H
+
+#include "io_ring.h"
+#include "mpx/pcb.h"
+
+/**
+ * @file aio.h
+ * @brief Contains the kernel side of submission/completion rings.
+ */
+
+/**
+ * @brief Performs a ring request for the calling PCB.
+ * @param action either IO_RING_SETUP or IO_RING_ENTER.
+ * @param ring the ring.
+ * @param min_complete the amount of completions to wait for, for IO_RING_ENTER.
+ * @param caller the calling PCB.
+ * @param ctx the caller's context, its EAX is set to the request's result.
+ * @return the wait queue the caller has to be parked in, or NULL if it can keep running.
+ */
+wait_queue_t *io_ring_request(op_code action, io_ring_t *ring, unsigned int min_complete, struct pcb *caller, struct context *ctx);
+
+/**
+ * @brief Takes new submissions from every registered ring, called by the kernel while scheduling
+ * so processes don't have to make a request to get their operations started.
+ */
+void io_ring_poll(void);
+
+/**
+ * @brief Posts a completion to the ring, waking its owner if it waits for enough completions.
+ * @param ring the ring.
+ * @param user_data the value given in the submission.
+ * @param result the amount of bytes transferred, or negative on error.
+ */
+void io_ring_post(io_ring_t *ring, int user_data, int result);
+
+/**
+ * @brief Unregisters the PCB's ring, used when the PCB is freed.
+ * @param pcb_ptr the PCB.
+ */
+void io_ring_release(struct pcb *pcb_ptr);
+
+#endif //F_R_I_D_A_Y_AIO_H
@@ -1,18 +1,28 @@
 #ifndef F_R_I_D_A_Y_ALARM_H
 #define F_R_I_D_A_Y_ALARM_H
 
+#include "stdbool.h"
+#include "mpx/pcb.h"
+
 /**
  * @file alarm.h
  * @brief A header file for alarm functions.
  */
 
 /**
- * @brief Creates a new pcb that will display message at or after given time
- * @param time_array the time to display message
+ * @brief Schedules the given message to be displayed at or after the given time.
+ * Alarms are kept in a deadline ordered heap and printed by a single dispatcher process.
+ * @param time_array the time to display message, in the current timezone.
  * @param message message to display
  * @return true if the alarm was created, false if it failed.
  * @author Kolby Eisenhauer, Andrew Bowie
  */
 bool create_new_alarm(int *time_array, const char* message);
 
+/**
+ * @brief Checks the earliest alarm deadline, and wakes the alarm dispatcher if it has passed.
+ * Called by the kernel before selecting the next PCB.
+ */
+void alarm_check(void);
+
 #endif
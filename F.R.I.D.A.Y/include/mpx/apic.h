@@ -0,0 +1,157 @@
+#ifndef F_R_I_D_A_Y_APIC_H
+#define F_R_I_D_A_Y_APIC_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/**
+ * @file apic.h
+ * @brief Contains access to the local APIC of the running CPU, and the IO APIC that routes the
+ * ISA interrupts. The IO APIC is found through the ACPI MADT.
+ */
+
+///The physical (and virtual, it's identity mapped) address of the local APIC.
+#define LAPIC_BASE 0xFEE00000
+
+///The physical (and virtual) address the IO APIC is expected at.
+#define IOAPIC_BASE 0xFEC00000
+///The amount of ISA interrupts.
+#define ISA_IRQS 16
+
+///The ID register.
+#define LAPIC_ID 0x020
+///The end of interrupt register.
+#define LAPIC_EOI 0x0B0
+///The spurious interrupt vector register, which also holds the software enable bit.
+#define LAPIC_SVR 0x0F0
+///The low half of the interrupt command register, writing it sends the IPI.
+#define LAPIC_ICR_LOW 0x300
+///The high half of the interrupt command register, holding the destination.
+#define LAPIC_ICR_HIGH 0x310
+
+///The LVT timer register.
+#define LAPIC_TIMER_LVT 0x320
+///The timer's initial count register.
+#define LAPIC_TIMER_INITIAL 0x380
+///The timer's current count register.
+#define LAPIC_TIMER_CURRENT 0x390
+///The timer's divide configuration register.
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+///The mask bit of LVT and redirection entries.
+#define APIC_MASKED (1 << 16)
+///The timer divide configuration for a divisor of 16.
+#define LAPIC_DIVIDE_16 0x3
+///The vector spurious interrupts are delivered at.
+#define LAPIC_SPURIOUS_IV 0xFF
+
+///An INIT IPI.
+#define LAPIC_IPI_INIT 0x00004500
+///A startup IPI, or'd with the page of the code to start at.
+#define LAPIC_IPI_STARTUP 0x00004600
+///A fixed IPI, or'd with the vector to deliver it at.
+#define LAPIC_IPI_FIXED 0x00004000
+
+/**
+ * @brief Reads a local APIC register.
+ * @param reg the register's offset.
+ * @return the value.
+ */
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return *(volatile uint32_t *) (LAPIC_BASE + reg);
+}
+
+/**
+ * @brief Writes a local APIC register.
+ * @param reg the register's offset.
+ * @param value the value.
+ */
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    *(volatile uint32_t *) (LAPIC_BASE + reg) = value;
+}
+
+///What the ACPI MADT says about the interrupt controllers.
+struct apic_config {
+    ///If a usable MADT was found.
+    bool found;
+    ///The address of the IO APIC handling the ISA interrupts.
+    uint32_t ioapic_addr;
+    ///The first global system interrupt of that IO APIC.
+    uint32_t gsi_base;
+    ///The global system interrupt of every ISA interrupt.
+    uint32_t irq_gsi[ISA_IRQS];
+    ///The MPS polarity and trigger flags of every ISA interrupt, 0 for the bus default.
+    uint16_t irq_flags[ISA_IRQS];
+};
+
+/**
+ * @brief Writes an IO APIC register.
+ * @param reg the register's index.
+ * @param value the value.
+ */
+static inline void ioapic_write(uint32_t reg, uint32_t value)
+{
+    *(volatile uint32_t *) IOAPIC_BASE = reg;
+    *(volatile uint32_t *) (IOAPIC_BASE + 0x10) = value;
+}
+
+/**
+ * @brief Finds the ACPI MADT and reads the interrupt controllers from it. The ACPI tables are at
+ * the top of memory, which isn't mapped, so this has to be called before paging is enabled.
+ * @return true if the IO APIC and local APIC are at the addresses they're mapped at.
+ */
+bool apic_detect(void);
+
+/**
+ * @brief Gets what @code apic_detect found.
+ * @return the configuration.
+ */
+const struct apic_config *apic_get_config(void);
+
+/**
+ * @brief Routes an ISA interrupt through the IO APIC to the boot CPU, or masks it.
+ * @param irq the ISA interrupt.
+ * @param vector the vector to deliver it at.
+ * @param enabled false to mask it.
+ */
+void ioapic_route(int irq, uint8_t vector, bool enabled);
+
+/**
+ * @brief Starts the local APIC timer in periodic mode.
+ * @param vector the vector to deliver it at.
+ * @param count the timer counts between interrupts, at a divisor of 16.
+ */
+void lapic_timer_start(uint8_t vector, uint32_t count);
+
+/**
+ * @brief Stops the local APIC timer.
+ */
+void lapic_timer_stop(void);
+
+/**
+ * @brief Checks if the CPU has a local APIC.
+ * @return true if it does.
+ */
+bool lapic_present(void);
+
+/**
+ * @brief Software enables the running CPU's local APIC.
+ */
+void lapic_enable(void);
+
+/**
+ * @brief Gets the ID of the running CPU's local APIC.
+ * @return the ID.
+ */
+uint8_t lapic_id(void);
+
+/**
+ * @brief Sends an inter-processor interrupt and waits for it to be delivered.
+ * @param dest the local APIC ID of the receiving CPU.
+ * @param command the delivery mode and vector.
+ */
+void lapic_send_ipi(uint8_t dest, uint32_t command);
+
+#endif //F_R_I_D_A_Y_APIC_H
@@ -0,0 +1,60 @@
+#ifndef F_R_I_D_A_Y_CPUID_H
+#define F_R_I_D_A_Y_CPUID_H
+
+#include "stdbool.h"
+#include "stddef.h"
+
+/**
+ * @file cpuid.h
+ * @brief Contains the CPU features probed with CPUID at boot.
+ */
+
+///The CPU features the kernel cares about.
+struct cpu_features {
+    ///The vendor string, such as "GenuineIntel".
+    char vendor[13];
+    ///Enhanced REP MOVSB/STOSB, making them the fastest way to copy and fill.
+    bool erms;
+    ///SSE, and with it MXCSR.
+    bool sse;
+    ///SSE2.
+    bool sse2;
+    ///FXSAVE and FXRSTOR.
+    bool fxsr;
+    ///4MB pages.
+    bool pse;
+    ///An on-chip local APIC.
+    bool apic;
+    ///A time stamp counter that runs at a constant rate in every power state.
+    bool invariant_tsc;
+};
+
+///The features of the boot CPU, filled in by @code cpuid_detect.
+extern struct cpu_features cpu_features;
+
+/**
+ * @brief Runs a CPUID leaf.
+ * @param leaf the leaf, in EAX.
+ * @param subleaf the subleaf, in ECX.
+ * @param regs where EAX, EBX, ECX and EDX are stored, in that order.
+ */
+static inline void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+    __asm__ volatile ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+            : "a"(leaf), "c"(subleaf));
+}
+
+/**
+ * @brief Probes the boot CPU's features into @code cpu_features, and picks the string
+ * functions that suit them.
+ */
+void cpuid_detect(void);
+
+/**
+ * @brief Describes the detected features, such as "GenuineIntel: ERMS SSE2 APIC".
+ * @param buf the buffer to write to.
+ * @param len the length of the buffer.
+ */
+void cpuid_describe(char *buf, size_t len);
+
+#endif //F_R_I_D_A_Y_CPUID_H
@@ -0,0 +1,48 @@
+#ifndef F_R_I_D_A_Y_FPU_H
+#define F_R_I_D_A_Y_FPU_H
+
+#include "mpx/pcb.h"
+
+/**
+ * @file fpu.h
+ * @brief Contains the lazy switching of the x87 and SSE registers. CR0.TS is set whenever a PCB
+ * other than the one owning the registers runs, so its first FPU or SSE instruction faults (#NM),
+ * and only then are the owner's registers saved and the new PCB's restored. PCBs that never use
+ * them get no save area and cost nothing on a switch.
+ */
+
+///The size of an FXSAVE area.
+#define FPU_STATE_SIZE 512
+///The alignment an FXSAVE area needs.
+#define FPU_STATE_ALIGN 16
+
+/**
+ * @brief Enables the FPU and SSE, and installs the #NM handler. Leaves CR0.TS set.
+ */
+void fpu_init(void);
+
+/**
+ * @brief Enables the FPU and SSE on the calling CPU, for the application processors that start
+ * after fpu_init. Leaves CR0.TS set.
+ */
+void fpu_init_cpu(void);
+
+/**
+ * @brief Sets or clears CR0.TS for the PCB about to run, called on every switch.
+ * @param next the PCB about to run.
+ */
+void fpu_switch(struct pcb *next);
+
+/**
+ * @brief Frees the PCB's save area and gives up its ownership of the registers.
+ * @param pcb_ptr the PCB being freed.
+ */
+void fpu_release(struct pcb *pcb_ptr);
+
+/**
+ * @brief Gets the amount of #NM faults that moved the registers to another PCB.
+ * @return the amount.
+ */
+unsigned int fpu_get_switches(void);
+
+#endif //F_R_I_D_A_Y_FPU_H
@@ -7,6 +7,7 @@
 
 #include "stddef.h"
 #include "stdbool.h"
+#include "mpx/pcb.h"
 
 /**
  * @file heap.h
@@ -52,5 +53,26 @@ void *allocate_memory(size_t size);
  */
 int free_memory(void* pointer);
 
+/**
+ * Gets the size of an allocated block, checking that the pointer really is one.
+ * @param pointer the address of the MB.
+ * @return the size of the block, or 0 if the pointer isn't an allocated block.
+ */
+size_t heap_block_size(void *pointer);
+
+/**
+ * Moves the ownership of an allocated block to another PCB, used when a buffer is handed over.
+ * @param pointer the address of the MB.
+ * @param owner the new owner, or NULL.
+ * @return true if the ownership moved, false if the pointer isn't an allocated block.
+ */
+bool heap_set_owner(void *pointer, struct pcb *owner);
+
+/**
+ * Forgets the PCB as the owner of every block it owns, used when the PCB is freed.
+ * @param owner the PCB.
+ */
+void heap_disown(struct pcb *owner);
+
 
 #endif //F_R_I_D_A_Y_HEAP_H
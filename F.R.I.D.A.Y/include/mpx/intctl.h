@@ -0,0 +1,75 @@
+#ifndef F_R_I_D_A_Y_INTCTL_H
+#define F_R_I_D_A_Y_INTCTL_H
+
+#include "stdbool.h"
+
+/**
+ * @file intctl.h
+ * @brief Contains the interrupt controller in use. The IO APIC routes the ISA interrupts and the
+ * local APIC timer drives the system tick when they were found, otherwise the 8259 PIC and the
+ * PIT are used. Every handler goes through @code intctl_eoi, which also times it.
+ */
+
+///The interrupt controllers.
+enum intctl_mode {
+    INTCTL_PIC = 0,
+    INTCTL_APIC = 1,
+};
+
+///The interrupt timing kept for each mode.
+struct intctl_stats {
+    ///The amount of interrupts handled.
+    unsigned int count;
+    ///The cycles between entering the handlers and finishing their EOI.
+    unsigned long long handler_cycles;
+    ///The cycles spent signalling EOI.
+    unsigned long long eoi_cycles;
+};
+
+/**
+ * @brief Switches to the APIC if @code apic_detect found it, calibrating the local APIC timer
+ * against the PIT. Needs the system tick to be running.
+ * @return the mode in use.
+ */
+enum intctl_mode intctl_init(void);
+
+/**
+ * @brief Switches the interrupt controller, moving every enabled interrupt over.
+ * @param mode the new mode.
+ * @return true if it was switched, false if the APIC isn't available.
+ */
+bool intctl_set_mode(enum intctl_mode mode);
+
+/**
+ * @brief Gets the interrupt controller in use.
+ * @return the mode.
+ */
+enum intctl_mode intctl_get_mode(void);
+
+/**
+ * @brief Unmasks an ISA interrupt, delivering it at 0x20 plus its number.
+ * @param irq the interrupt.
+ */
+void intctl_enable_irq(int irq);
+
+/**
+ * @brief Masks an ISA interrupt.
+ * @param irq the interrupt.
+ */
+void intctl_disable_irq(int irq);
+
+/**
+ * @brief Signals the end of an interrupt to the controller in use, and records its timing.
+ * @param irq the interrupt.
+ * @param entered_at the time stamp the handler was entered at.
+ */
+void intctl_eoi(int irq, unsigned long long entered_at);
+
+/**
+ * @brief Gets the interrupt timing for a mode.
+ * @param mode the mode.
+ * @return the timing.
+ */
+const struct intctl_stats *intctl_get_stats(enum intctl_mode mode);
+
+#endif //F_R_I_D_A_Y_INTCTL_H
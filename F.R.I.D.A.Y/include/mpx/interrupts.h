@@ -12,6 +12,24 @@
 /** Enable interrupts */
 #define cli() __asm__ volatile ("cli")
 
+/**
+ Disables interrupts, returning the EFLAGS from before so they can be restored
+ with irq_restore. Safe to use where interrupts may already be off.
+*/
+static inline unsigned int irq_save(void)
+{
+	unsigned int flags;
+	__asm__ volatile ("pushfl\n\tpopl %0\n\tcli" : "=r"(flags) : : "memory");
+	return flags;
+}
+
+/** Turns interrupts back on if they were on when irq_save was called. */
+static inline void irq_restore(unsigned int flags)
+{
+	if (flags & 0x200)
+		sti();
+}
+
 /**
  Installs the initial interrupt handlers for the first 32 IRQ lines. Most do a
  panic for now.
@@ -0,0 +1,30 @@
+#ifndef F_R_I_D_A_Y_IPC_H
+#define F_R_I_D_A_Y_IPC_H
+
+#include "mailbox.h"
+#include "sys_req.h"
+#include "mpx/pcb.h"
+
+/**
+ * @file ipc.h
+ * @brief Contains the kernel side of process mailboxes.
+ */
+
+/**
+ * @brief Performs a message request for the calling PCB.
+ * @param action one of MSG_SEND, MSG_RECEIVE or MSG_TRY_RECEIVE.
+ * @param to the name of the receiving PCB, for MSG_SEND.
+ * @param msg the message to send, for MSG_SEND.
+ * @param caller the calling PCB.
+ * @param ctx the caller's context, its EAX is set to the request's result.
+ * @return the wait queue the caller has to be parked in, or NULL if it can keep running.
+ */
+wait_queue_t *mailbox_request(op_code action, const char *to, message_t *msg, struct pcb *caller, struct context *ctx);
+
+/**
+ * @brief Frees every message left in the PCB's mailbox, used when the PCB is freed.
+ * @param pcb_ptr the PCB.
+ */
+void mailbox_clear(struct pcb *pcb_ptr);
+
+#endif //F_R_I_D_A_Y_IPC_H
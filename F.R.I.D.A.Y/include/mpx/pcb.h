@@ -1,5 +1,6 @@
 #include "stdbool.h"
 #include "stddef.h"
+#include "mailbox.h"
 #ifndef MPX_PCB_H
 #define MPX_PCB_H
 
@@ -17,6 +18,8 @@
 enum pcb_class {
     USER = 0,
     SYSTEM = 1,
+    ///Scheduled by earliest deadline, a PCB only joins this class through admission control.
+    REALTIME = 2,
 };
 
 ///The execution state of a PCB.
@@ -32,6 +35,48 @@ enum pcb_dispatch_state {
     SUSPENDED = 1,
 };
 
+///The accounting kept for every PCB.
+struct pcb_stats {
+    ///The total cycles spent running.
+    unsigned long long run_cycles;
+    ///The time stamp of the last dispatch.
+    unsigned long long dispatched_at;
+    ///The run cycles when 'top' last sampled this PCB.
+    unsigned long long sampled_cycles;
+    ///The amount of times this PCB was dispatched.
+    unsigned int dispatches;
+    ///The amount of times this PCB gave up the CPU to wait for something.
+    unsigned int voluntary_switches;
+    ///The amount of times this PCB was switched away from while it could still run.
+    unsigned int involuntary_switches;
+    ///The total bytes read by this PCB.
+    unsigned int bytes_read;
+    ///The total bytes written by this PCB.
+    unsigned int bytes_written;
+    ///The heap bytes this PCB currently owns.
+    unsigned int heap_bytes;
+};
+
+///The timing of a REALTIME PCB, in ticks.
+struct pcb_edf {
+    ///The ticks between the releases of its jobs.
+    unsigned int period;
+    ///The ticks each job is expected to run for.
+    unsigned int budget;
+    ///The tick the current job was released at.
+    unsigned int release;
+    ///The tick the current job has to finish by.
+    unsigned int deadline;
+    ///The run cycles of the PCB when the current job started.
+    unsigned long long job_start;
+    ///The amount of jobs finished.
+    unsigned int jobs;
+    ///The amount of jobs that finished after their deadline, or were never started.
+    unsigned int misses;
+    ///The amount of jobs that ran longer than the budget.
+    unsigned int overruns;
+};
+
 ///The definition of a process control block.
 struct pcb {
     ///This exists as an extremely hacky way to use them in the linked list without allocating memory.
@@ -49,6 +94,38 @@ struct pcb {
     enum pcb_exec_state exec_state;
     ///The dispatch state of this PCB.
     enum pcb_dispatch_state dispatch_state;
+    ///The wait queue this PCB is parked in, or NULL if it isn't parked.
+    struct wait_queue *waiting_on;
+    ///The next PCB parked in the same wait queue.
+    struct pcb *wait_next;
+    ///The next parked PCB, in any wait queue.
+    struct pcb *parked_next;
+    ///The previous parked PCB, in any wait queue.
+    struct pcb *parked_prev;
+    ///The mutexes this PCB holds, linked through next_held.
+    struct mutex *held_mutexes;
+    ///The messages sent to this PCB.
+    mailbox_t mailbox;
+    ///The submission/completion ring registered by this PCB, or NULL.
+    struct io_ring *io_ring;
+    ///The tick this PCB wakes up at, while it sleeps.
+    unsigned int wake_tick;
+    ///The accounting for this PCB.
+    struct pcb_stats stats;
+    ///The MLFQ level, 0 being the top.
+    int mlfq_level;
+    ///The ticks run at the current MLFQ level.
+    unsigned int mlfq_used;
+    ///The tick of the last dispatch.
+    unsigned int dispatch_tick;
+    ///The time stamp the PCB's IO completed at, or 0 once it has been dispatched.
+    unsigned long long io_completed_at;
+    ///The timing of the PCB, if it's REALTIME.
+    struct pcb_edf edf;
+    ///The saved FPU and SSE registers, 16 byte aligned, or NULL if the PCB never used them.
+    void *fpu_state;
+    ///The allocation holding the saved registers.
+    void *fpu_alloc;
     ///A pointer to the next available byte in the stack.
     void *stack_ptr;
     ///The stack itself.
@@ -83,6 +160,13 @@ struct pcb *peek_next_pcb(void);
  */
 struct pcb *poll_next_pcb(void);
 
+/**
+ * @brief Polls the first PCB of the class that's ready and not suspended.
+ * @param class the class.
+ * @return the PCB, or NULL if none is.
+ */
+struct pcb *poll_next_pcb_of(enum pcb_class class);
+
 /**
  * @brief Allocates memory for a PCB block.
  *
@@ -126,6 +210,20 @@ void pcb_insert(struct pcb* pcb_ptr);
  */
 struct pcb *pcb_find(const char *name);
 
+/**
+ * @brief Finds the PCB with the given name, including one that's running on any CPU.
+ * @param name the name of the PCB.
+ * @return the pcb found, or NULL if not found.
+ */
+struct pcb *pcb_find_any(const char *name);
+
+/**
+ * @brief Gets the CPU the PCB is running on.
+ * @param pcb_ptr the PCB.
+ * @return the index of the CPU, or -1 if it isn't running.
+ */
+int pcb_running_cpu(struct pcb *pcb_ptr);
+
 /**
  * @brief Removes a given PCB from the list.
  *
@@ -152,6 +250,40 @@ bool generate_new_pcb(const char *name,
                       size_t input_len,
                       size_t param_ptrs);
 
+/**
+ * @brief Moves the PCB to its new place in the queue after its state or priority changed.
+ * Parked PCBs keep their place in their wait queue, and are re-sorted when they're woken.
+ * @param pcb_ptr the PCB.
+ */
+void pcb_requeue(struct pcb *pcb_ptr);
+
+/**
+ * @brief Puts the queue back in order after the priorities of the PCBs in it changed. Nothing is
+ * allocated, and PCBs that compare equal keep their order.
+ */
+void pcb_resort(void);
+
+/**
+ * @brief Calls the function on every PCB: the running ones, the ones in the queue and the parked ones.
+ * @param call the function, which must not move PCBs in or out of the queue.
+ */
+void pcb_for_each(void call(struct pcb *pcb_ptr));
+
+/**
+ * @brief Collects every PCB: the running ones, the ones in the queue and the parked ones.
+ * @param out the array to store them in.
+ * @param max the length of the array.
+ * @return the amount of PCBs stored.
+ */
+size_t pcb_collect(struct pcb **out, size_t max);
+
+/**
+ * @brief Gets the execution state name from the given enum.
+ * @param state the state of the execution.
+ * @return the string representation.
+ */
+const char *get_exec_state_name(enum pcb_exec_state state);
+
 /**
  * @brief Runs the PCB command from the given string.
  * @param comm the command.
@@ -0,0 +1,142 @@
+#ifndef F_R_I_D_A_Y_SCHED_H
+#define F_R_I_D_A_Y_SCHED_H
+
+#include "stdbool.h"
+#include "mpx/pcb.h"
+#include "mpx/wait_queue.h"
+
+/**
+ * @file sched.h
+ * @brief Contains the scheduling policies. Under the priority policy PCBs are ordered by their fixed
+ * priority. Under the multilevel feedback queue (MLFQ) policy USER PCBs move between levels instead:
+ * using up a level's quantum demotes them, blocking on IO boosts them, and every PCB is periodically
+ * reset to the top level so nothing starves. Under both policies REALTIME PCBs run first, ordered by
+ * the deadline of their current job (earliest deadline first).
+ */
+
+///The scheduling policies.
+enum sched_policy {
+    SCHED_PRIORITY = 0,
+    SCHED_MLFQ = 1,
+};
+
+///The amount of MLFQ levels.
+#define MLFQ_LEVELS 4
+///The priority of the top MLFQ level, each level below is 2 priorities lower.
+#define MLFQ_TOP_PRIORITY 1
+///The ticks a PCB may run at the top level before it's demoted, doubling with every level.
+#define MLFQ_BASE_QUANTUM 2
+///The ticks between every reset to the top level.
+#define MLFQ_RESET_TICKS 100
+
+///The share of the CPU all REALTIME PCBs may reserve together, in thousandths.
+#define EDF_MAX_UTILIZATION 800
+
+///The wake up latency of PCBs whose IO completed, kept per policy.
+struct sched_latency {
+    ///The amount of wake ups measured.
+    unsigned int count;
+    ///The total cycles between completion and dispatch.
+    unsigned long long total_cycles;
+    ///The longest wait.
+    unsigned long long max_cycles;
+};
+
+/**
+ * @brief Gets the active scheduling policy.
+ * @return the policy.
+ */
+enum sched_policy sched_get_policy(void);
+
+/**
+ * @brief Changes the scheduling policy, re-sorting the PCB queue.
+ * @param policy the new policy.
+ */
+void sched_set_policy(enum sched_policy policy);
+
+/**
+ * @brief Compares the scheduling order of two PCBs that are in the same state.
+ * @param pcb_ptr1 the first PCB.
+ * @param pcb_ptr2 the second PCB.
+ * @return less than 0 if the first PCB runs first, more than 0 if the second does.
+ */
+int sched_compare(const struct pcb *pcb_ptr1, const struct pcb *pcb_ptr2);
+
+/**
+ * @brief Gets the priority the PCB is scheduled with under the active policy.
+ * @param pcb_ptr the PCB.
+ * @return the priority, lower runs first.
+ */
+int sched_priority(const struct pcb *pcb_ptr);
+
+/**
+ * @brief Updates the PCB's level after it gave up the CPU, before it goes back into the queue.
+ * @param pcb_ptr the PCB.
+ * @param io_blocked if it blocked on an IO operation.
+ */
+void sched_switched_out(struct pcb *pcb_ptr, bool io_blocked);
+
+/**
+ * @brief Records the dispatch of the PCB, including the latency since its IO completed.
+ * @param pcb_ptr the PCB.
+ * @param now the current time stamp.
+ */
+void sched_dispatched(struct pcb *pcb_ptr, unsigned long long now);
+
+/**
+ * @brief Resets every USER PCB to the top level when the reset period has passed.
+ * Called by the kernel before selecting the next PCB.
+ */
+void sched_check(void);
+
+/**
+ * @brief Gets the IO wake up latency measured under the given policy.
+ * @param policy the policy.
+ * @return the latency.
+ */
+const struct sched_latency *sched_get_latency(enum sched_policy policy);
+
+/**
+ * @brief Gets the amount of demotions, boosts and resets done by the MLFQ policy.
+ * @param demotions where the demotions are stored.
+ * @param boosts where the boosts are stored.
+ * @param resets where the resets are stored.
+ */
+void sched_get_mlfq_stats(unsigned int *demotions, unsigned int *boosts, unsigned int *resets);
+
+/**
+ * @brief Makes the PCB REALTIME with the given period and budget, if the CPU share it asks for is
+ * still free. Its first job is released immediately.
+ * @param caller the PCB.
+ * @param period the ticks between the releases of its jobs, which is also each job's relative deadline.
+ * @param budget the ticks each job runs for at most.
+ * @return 0 if it was admitted, or INVALID_OPERATION if it wasn't.
+ */
+int sched_edf_admit(struct pcb *caller, unsigned int period, unsigned int budget);
+
+/**
+ * @brief Finishes the REALTIME PCB's current job, counting a miss if it's late, and releases the next.
+ * @param caller the PCB.
+ * @return the wait queue to park the PCB in until the next release, or NULL if it can start now.
+ */
+wait_queue_t *sched_edf_wait(struct pcb *caller);
+
+/**
+ * @brief Gives back the CPU share reserved by the PCB, called when it's freed.
+ * @param pcb_ptr the PCB.
+ */
+void sched_edf_release(struct pcb *pcb_ptr);
+
+/**
+ * @brief Gets the CPU share reserved by REALTIME PCBs.
+ * @return the share, in thousandths.
+ */
+unsigned int sched_edf_utilization(void);
+
+/**
+ * @brief Gets the deadline misses of every REALTIME PCB, including the ones that have exited.
+ * @return the amount of misses.
+ */
+unsigned int sched_edf_misses(void);
+
+#endif //F_R_I_D_A_Y_SCHED_H
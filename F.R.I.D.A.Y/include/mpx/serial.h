@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include "mpx/pcb.h"
 #include <mpx/device.h>
+#include "io_ring.h"
 
 /**
  @file mpx/serial.h
@@ -27,10 +28,24 @@ typedef enum {
 
 /**
  * @brief Checks for any completed PCBs that were doing IO operations.
+ * Only DCBs placed on the completion list by the serial interrupt handlers are examined.
  * @return a PCB to load, or NULL.
  */
 struct pcb *check_completed(void);
 
+/**
+ * @brief Checks if any DCB has completed an operation that hasn't been handled by @code check_completed yet.
+ * @return true if a completion is waiting.
+ */
+bool io_completion_pending(void);
+
+/**
+ * @brief Gets the amount of characters typed on the device that no read has taken yet.
+ * @param dev the device.
+ * @return the amount of buffered characters, 0 if the device isn't open.
+ */
+size_t serial_input_available(device dev);
+
 /**
  * @brief Performs an IO operation on the given device, returning the result.
  *
@@ -39,9 +54,169 @@ struct pcb *check_completed(void);
  * @param dev the device.
  * @param buffer the buffer.
  * @param length the amount of characters to transfer.
+ * @param transferred set to the amount of characters transferred when it's SERVICED.
  * @return the result of the operation.
  */
-io_req_result io_request(struct pcb *pcb, op_code operation, device dev, char *buffer, size_t length);
+io_req_result io_request(struct pcb *pcb, op_code operation, device dev, char *buffer, size_t length,
+                         size_t *transferred);
+
+/**
+ * @brief Starts or queues an IO operation submitted through a ring. No process is blocked,
+ * the result is posted to the ring's completion queue once it finishes.
+ *
+ * @param ring the ring the operation came from.
+ * @param user_data the value to post with the completion.
+ * @param operation the operation.
+ * @param dev the device.
+ * @param buffer the buffer.
+ * @param length the amount of characters to transfer.
+ * @return INVALID_PARAMS or DEVICE_CLOSED if it wasn't started, otherwise DEVICE_BUSY or PARTIALLY_SERVICED.
+ */
+io_req_result io_submit(struct io_ring *ring, int user_data, op_code operation, device dev, char *buffer, size_t length);
+
+/**
+ * @brief Cancels every operation submitted through the ring. Queued ones are dropped and the
+ * active one is stopped, and none of them post a completion.
+ *
+ * @param ring the ring.
+ */
+void io_cancel_ring(struct io_ring *ring);
+
+///The UART chips that can be told apart by probing.
+enum uart_type {
+    UART_NONE = 0,
+    UART_8250 = 1,
+    UART_16450 = 2,
+    UART_16550 = 3,
+    UART_16550A = 4,
+    UART_16750 = 5,
+};
+
+///The baud rate ports are set up with, both for polling and once they're opened.
+#define SERIAL_DEFAULT_BAUD 19200
+///The clock the UART divides down to the baud rate, the fastest rate it can run at.
+#define SERIAL_MAX_BAUD 115200
+
+///The flow control a serial port can use.
+enum serial_flow {
+    ///The sender is never held back.
+    SERIAL_FLOW_NONE = 0,
+    ///Hardware flow control, RTS is dropped to stop the other side and it drops CTS to stop this one.
+    SERIAL_FLOW_RTSCTS = 1,
+    ///Software flow control, XOFF and XON characters are sent in the data to stop and resume.
+    SERIAL_FLOW_XONXOFF = 2,
+};
+
+///The line settings of a serial port.
+struct serial_config {
+    ///The baud rate, which has to divide SERIAL_MAX_BAUD.
+    int baud;
+    ///The data bits per character, from 5 to 8.
+    int data_bits;
+    ///The parity, 'n' for none, 'o' odd, 'e' even, 'm' mark or 's' space.
+    char parity;
+    ///The stop bits per character, 1 or 2.
+    int stop_bits;
+    ///The flow control.
+    enum serial_flow flow;
+};
+
+///The receive loss and flow control counters of a device.
+struct serial_flow_stats {
+    ///The bytes thrown away because the receive ring was full.
+    unsigned int dropped;
+    ///The bytes the UART lost because it wasn't emptied in time.
+    unsigned int overruns;
+    ///The times the other side was told to stop sending.
+    unsigned int throttles;
+    ///The times the other side told this one to stop sending.
+    unsigned int stops;
+    ///If the other side is told to stop sending right now.
+    bool throttled;
+    ///If this side is stopped from sending right now.
+    bool stopped;
+};
+
+///The default size of a device's receive ring.
+#define SERIAL_RX_RING_DEFAULT 256
+///The default size of a device's transmit ring.
+#define SERIAL_TX_RING_DEFAULT 1024
+
+///The transmit interrupt counters of a device.
+struct serial_tx_stats {
+    ///The amount of transmit holding register empty interrupts handled.
+    unsigned int thre_interrupts;
+    ///The amount of bytes handed to the UART by interrupts and writes.
+    unsigned int bytes;
+    ///The cycles spent in the output handler.
+    unsigned long long isr_cycles;
+};
+
+///The line disciplines a device's input can go through.
+enum serial_mode {
+    ///Reads are edited as a line, with echo, history and completions, until a newline.
+    SERIAL_COOKED = 0,
+    ///Reads take the bytes as they arrive, without echo or editing.
+    SERIAL_RAW = 1,
+};
+
+///The echo counters of a device.
+struct serial_echo_stats {
+    ///The amount of keystrokes echoed.
+    unsigned int keystrokes;
+    ///The amount of bytes written to echo them.
+    unsigned int bytes;
+    ///The amount of echoes timed.
+    unsigned int latency_samples;
+    ///The cycles from the input interrupts to their echoes reaching the UART.
+    unsigned long long latency_cycles;
+    ///The longest of those.
+    unsigned long long max_latency_cycles;
+};
+
+///The kinds of interrupt a UART raises, by what the interrupt identification register reports.
+enum serial_irq_kind {
+    ///A modem status line, like CTS, changed.
+    SERIAL_IRQ_MODEM = 0,
+    ///The transmitter is ready for more bytes.
+    SERIAL_IRQ_TX = 1,
+    ///The receive FIFO reached its threshold.
+    SERIAL_IRQ_RX = 2,
+    ///A receive error, like an overrun, happened.
+    SERIAL_IRQ_LINE = 3,
+    ///Bytes sat in the receive FIFO under its threshold.
+    SERIAL_IRQ_TIMEOUT = 4,
+    ///The amount of kinds.
+    SERIAL_IRQ_KINDS = 5,
+};
+
+///The traffic counters of a device.
+struct serial_dev_stats {
+    ///The interrupts serviced, by serial_irq_kind.
+    unsigned int interrupts[SERIAL_IRQ_KINDS];
+    ///The bytes received from the UART.
+    unsigned int bytes_in;
+    ///The bytes handed to the UART.
+    unsigned int bytes_out;
+    ///The most bytes the receive ring has held.
+    size_t rx_high_water;
+    ///The size of the receive ring.
+    size_t rx_capacity;
+    ///The most bytes the transmit ring has held.
+    size_t tx_high_water;
+    ///The size of the transmit ring.
+    size_t tx_capacity;
+    ///The operations waiting for the device right now.
+    size_t queue_depth;
+    ///The most operations that have waited for the device at once.
+    size_t max_queue_depth;
+    ///The times a process was blocked on the device.
+    unsigned int blocked_waits;
+    ///The cycles processes spent blocked on the device, from the request to being resumed.
+    unsigned long long blocked_cycles;
+    ///The longest of those waits.
+    unsigned long long max_blocked_cycles;
+};
 
 /**
  Initializes devices for user input and output
@@ -50,12 +225,137 @@ io_req_result io_request(struct pcb *pcb, op_code operation, device dev, char *b
 */
 int serial_init(device dev);
 
+/**
+ * @brief Changes the line settings of the device. Output already written, including the rest
+ * of a write in progress, is sent with the old settings first. This yields with sys_req while
+ * the output drains, so it has to be called from a process.
+ * @param dev the device.
+ * @param config the new settings.
+ * @return 0 on success, -102 for a baud rate the UART can't divide to, -1 for other invalid settings.
+ */
+int serial_configure(device dev, const struct serial_config *config);
+
+/**
+ * @brief Gets the receive loss and flow control counters of the device.
+ * @param dev the device.
+ * @param stats where to copy the counters to.
+ * @param reset true to clear them after they're read.
+ * @return true if they were copied, false if the device is invalid.
+ */
+bool serial_get_flow_stats(device dev, struct serial_flow_stats *stats, bool reset);
+
+/**
+ * @brief Gets the traffic counters of the device.
+ * @param dev the device.
+ * @param stats where to copy the counters to.
+ * @param reset true to clear them after they're read, the high-water marks start over from the current levels.
+ * @return true if they were copied, false if the device is invalid or not open.
+ */
+bool serial_get_dev_stats(device dev, struct serial_dev_stats *stats, bool reset);
+
+/**
+ * @brief Gets the line settings of the device.
+ * @param dev the device.
+ * @param config where to copy the settings to.
+ * @return true if they were copied, false if the device is invalid.
+ */
+bool serial_get_config(device dev, struct serial_config *config);
+
+/**
+ * @brief Gets the amount of bytes written to the device that the UART hasn't taken yet.
+ * Writes return once their bytes are in the device's transmit ring, so this is what's left of them.
+ * @param dev the device.
+ * @return the amount of bytes, 0 if the device isn't open.
+ */
+size_t serial_output_pending(device dev);
+
+/**
+ * @brief Gets the UART found on the device by @code serial_init.
+ * @param dev the device.
+ * @return the UART type, or UART_NONE if it wasn't initialized.
+ */
+enum uart_type serial_get_uart(device dev);
+
+/**
+ * @brief Gets the name of the UART type.
+ * @param type the type.
+ * @return the name, like "16550A".
+ */
+const char *serial_uart_name(enum uart_type type);
+
+/**
+ * @brief Gets the transmit FIFO depth of the device's UART.
+ * @param dev the device.
+ * @return the bytes the UART takes per transmit interrupt, 1 if it has no working FIFO.
+ */
+size_t serial_get_fifo_depth(device dev);
+
+/**
+ * @brief Sets if the output interrupt fills the whole transmit FIFO, or sends a single byte.
+ * @param dev the device.
+ * @param enabled true to fill the FIFO, false to send a byte per interrupt.
+ */
+void serial_set_tx_fifo(device dev, bool enabled);
+
+/**
+ * @brief Checks if the output interrupt fills the whole transmit FIFO.
+ * @param dev the device.
+ * @return true if it does, false if it sends a byte per interrupt.
+ */
+bool serial_get_tx_fifo(device dev);
+
+/**
+ * @brief Gets the receive FIFO threshold of the device, which switches between 1 byte while
+ * someone is typing and 14 bytes during bulk input.
+ * @param dev the device.
+ * @return the threshold in bytes.
+ */
+int serial_get_rx_trigger(device dev);
+
+/**
+ * @brief Gets the transmit counters of the device.
+ * @param dev the device.
+ * @param stats where to copy the counters to.
+ * @param reset true to clear them after they're read.
+ * @return true if they were copied, false if the device is invalid.
+ */
+bool serial_get_tx_stats(device dev, struct serial_tx_stats *stats, bool reset);
+
+/**
+ * @brief Sets the line discipline of the device's input. A raw read completes as soon as any
+ * bytes are available, with as many of them as fit.
+ * @param dev the device.
+ * @param mode the line discipline.
+ * @param nonblocking true if raw reads with nothing available complete at once with no bytes.
+ * @return 0 on success, negative values if the device is invalid.
+ */
+int serial_set_mode(device dev, enum serial_mode mode, bool nonblocking);
+
+/**
+ * @brief Gets the line discipline of the device's input.
+ * @param dev the device.
+ * @return the line discipline, SERIAL_COOKED for an invalid device.
+ */
+enum serial_mode serial_get_mode(device dev);
+
+/**
+ * @brief Gets the echo counters of the device.
+ * @param dev the device.
+ * @param stats where to copy the counters to.
+ * @param reset true to clear them after they're read.
+ * @return true if they were copied, false if the device is invalid.
+ */
+bool serial_get_echo_stats(device dev, struct serial_echo_stats *stats, bool reset);
+
 /**
  Initializes devices for user input and output
  @param device A serial port to initialize (COM1, COM2, COM3, or COM4)
+ @param speed the baud rate.
+ @param rx_size the bytes the receive ring holds, rounded up to a power of two.
+ @param tx_size the bytes the transmit ring holds, rounded up to a power of two.
  @return 0 on success, non-zero on failure
 */
-int serial_open(device dev, int speed);
+int serial_open(device dev, int speed, size_t rx_size, size_t tx_size);
 
 /**
  * @brief Closes the given device.
@@ -66,7 +366,7 @@ int serial_open(device dev, int speed);
 int serial_close(device dev);
 
 /**
- Writes a buffer to a serial port
+ Writes a buffer to a serial port. If interrupts are off, this waits until all of it is sent.
  @param device The serial port to output to
  @param buffer A pointer to an array of characters to output
  @param len The number of bytes to write
@@ -74,6 +374,16 @@ int serial_close(device dev);
 */
 int serial_out(device dev, const char *buffer, size_t len);
 
+/**
+ * @brief Writes every segment to a serial port like @code serial_out, kicking the UART once
+ * after all of them are in the transmit ring.
+ * @param dev the serial port to output to.
+ * @param segments the segments.
+ * @param count the amount of segments.
+ * @return the total number of bytes written, or negative on error.
+ */
+int serial_outv(device dev, const io_segment_t *segments, size_t count);
+
 /**
  * @brief Writes len bytes from the given buffer to the device.
  * @param dev the device to write to.
@@ -83,6 +393,16 @@ int serial_out(device dev, const char *buffer, size_t len);
  */
 int serial_write(device dev, char *buffer, size_t len);
 
+/**
+ * @brief Writes every segment to the device as one operation, the output interrupt moves from
+ * one segment to the next so nothing has to be copied into a single buffer.
+ * @param dev the device to write to.
+ * @param segments the segments, which must stay valid until the write completes.
+ * @param count the amount of segments.
+ * @return 0 on success, negative values on error.
+ */
+int serial_writev(device dev, const io_segment_t *segments, size_t count);
+
 /**
  * @brief Reads input on the given device.
  *
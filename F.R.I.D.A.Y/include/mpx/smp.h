@@ -0,0 +1,111 @@
+#ifndef F_R_I_D_A_Y_SMP_H
+#define F_R_I_D_A_Y_SMP_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/**
+ * @file smp.h
+ * @brief Contains the discovery and start up of the other CPUs (the application processors),
+ * and the kernel lock that lets them share the kernel.
+ *
+ * Every CPU pulls from the one PCB queue, so a ready process runs on whichever CPU frees up first.
+ * The application processors only run user processes. System processes (the command handler,
+ * the alarm dispatcher) and every device interrupt stay on the boot CPU.
+ *
+ * The kernel is guarded by a single recursive lock. A CPU takes it when entering the kernel
+ * (system calls, interrupts, the heap), and a CPU running a system process keeps holding it, as
+ * system processes call into the kernel directly. A CPU running a user process, or idling,
+ * holds nothing.
+ */
+
+struct pcb;
+struct context;
+
+///The most CPUs that are tracked.
+#define SMP_MAX_CPUS 8
+
+///A single CPU.
+struct cpu {
+    ///The ID of the CPU's local APIC.
+    uint8_t lapic_id;
+    ///If this is the CPU the kernel booted on.
+    bool boot_cpu;
+    ///If the CPU is running, set by the CPU itself once it's started.
+    volatile bool online;
+    ///The PCB the CPU is running, NULL before its first dispatch.
+    struct pcb *active;
+    ///The CPU's idle process. On an application processor it's never in the PCB queue.
+    struct pcb *idle;
+    ///The context the CPU was in when it first called into the kernel.
+    struct context *first_context;
+};
+
+/**
+ * @brief Finds every CPU in the BIOS's MP configuration table, and starts the application
+ * processors with INIT and startup IPIs. Needs the system tick to be running.
+ * @return the amount of application processors that were started.
+ */
+int smp_init(void);
+
+/**
+ * @brief Gets the amount of CPUs found.
+ * @return the amount, at least 1.
+ */
+int smp_cpu_count(void);
+
+/**
+ * @brief Gets a CPU.
+ * @param index the index of the CPU, less than @code smp_cpu_count.
+ * @return the CPU.
+ */
+const struct cpu *smp_get_cpu(int index);
+
+/**
+ * @brief Gets the index of the CPU running the caller.
+ * @return the index, 0 until the application processors are found.
+ */
+int smp_cpu_index(void);
+
+/**
+ * @brief Gets the CPU running the caller.
+ * @return the CPU.
+ */
+struct cpu *smp_this_cpu(void);
+
+/**
+ * @brief Gives every started application processor an idle process, and lets them start
+ * scheduling. Called once the boot CPU is about to dispatch its first process.
+ */
+void smp_start_scheduling(void);
+
+/**
+ * @brief Checks if processes are being run on more than one CPU.
+ * @return true once an application processor is scheduling.
+ */
+bool smp_running(void);
+
+/**
+ * @brief Wakes an application processor that's idling, so it picks up a newly ready user process.
+ */
+void smp_wake_idle(void);
+
+/**
+ * @brief Takes the kernel lock, spinning while another CPU holds it. A CPU may take it again
+ * while already holding it. Must be called with interrupts off.
+ */
+void kernel_lock(void);
+
+/**
+ * @brief Undoes one kernel_lock, releasing the lock when it isn't held anymore.
+ */
+void kernel_unlock(void);
+
+/**
+ * @brief Called by the interrupt stubs after switching to the stack being resumed. Keeps the
+ * kernel lock if the CPU is resuming the kernel or a system process, otherwise releases it.
+ * Until then, no other CPU can pick up the PCB whose stack was just left.
+ */
+void kernel_exit(void);
+
+#endif //F_R_I_D_A_Y_SMP_H
@@ -0,0 +1,42 @@
+#ifndef F_R_I_D_A_Y_SYS_CALL_H
+#define F_R_I_D_A_Y_SYS_CALL_H
+
+#include "mpx/pcb.h"
+#include "sys_req.h"
+
+/**
+ * @file sys_call.h
+ * @brief Contains the kernel side of system requests and context switching.
+ */
+
+/**
+ * @brief The main system call function, called by the system call interrupt handler.
+ * @param action the action to perform.
+ * @param ctx the current PCB context.
+ * @return a pointer to the next context to load.
+ */
+struct context *sys_call(op_code action, struct context *ctx);
+
+/**
+ * @brief Gets the PCB that is currently running.
+ * @return the running PCB, or NULL before the first dispatch.
+ */
+struct pcb *get_active_pcb(void);
+
+/**
+ * @brief Registers the idle process with the kernel. The idle process is the only
+ * process that may be switched away from inside an interrupt handler, as it never holds
+ * any kernel state.
+ * @param pcb_ptr the idle PCB.
+ */
+void set_idle_pcb(struct pcb *pcb_ptr);
+
+/**
+ * @brief Called at the end of a hardware interrupt. If the idle process was interrupted and
+ * a PCB became ready (IO completed, or an alarm expired), that PCB is switched to immediately.
+ * @param ctx the context of the interrupted process.
+ * @return the context to return to.
+ */
+struct context *irq_reschedule(struct context *ctx);
+
+#endif //F_R_I_D_A_Y_SYS_CALL_H
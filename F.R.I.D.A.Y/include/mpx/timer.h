@@ -0,0 +1,76 @@
+#ifndef F_R_I_D_A_Y_TIMER_H
+#define F_R_I_D_A_Y_TIMER_H
+
+#include "stdbool.h"
+#include "mpx/pcb.h"
+#include "sync.h"
+
+/**
+ * @file timer.h
+ * @brief Contains the system tick, cycle counting and idle time accounting.
+ */
+
+///The frequency of the system tick, in Hz.
+#define TIMER_HZ 100
+
+/**
+ * @brief Reads the CPU's time stamp counter.
+ * @return the amount of cycles since the CPU was reset.
+ */
+static inline unsigned long long rdtsc(void)
+{
+    unsigned long long cycles;
+    __asm__ volatile ("rdtsc" : "=A"(cycles));
+    return cycles;
+}
+
+/**
+ * @brief Puts the calling PCB to sleep for the given amount of ticks.
+ * @param ticks the amount of ticks to sleep.
+ * @param caller the calling PCB.
+ * @return the wait queue the caller has to be parked in.
+ */
+wait_queue_t *sleep_request(unsigned int ticks, struct pcb *caller);
+
+/**
+ * @brief Wakes every sleeping PCB whose tick has come, called by the kernel before selecting the next PCB.
+ */
+void sleep_check(void);
+
+/**
+ * @brief Programs the PIT to fire the system tick at @code TIMER_HZ and installs its handler.
+ * Also records the boot time stamp used for utilisation numbers.
+ */
+void timer_init(void);
+
+/**
+ * @brief Gets the amount of system ticks since @code timer_init was called.
+ * @return the tick count.
+ */
+unsigned int get_ticks(void);
+
+/**
+ * @brief Gets the amount of CPU cycles since @code timer_init was called.
+ * @return the cycle count.
+ */
+unsigned long long get_uptime_cycles(void);
+
+/**
+ * @brief Gets the amount of CPU cycles spent halted in the idle process.
+ * @return the cycle count.
+ */
+unsigned long long get_idle_cycles(void);
+
+/**
+ * @brief Halts the CPU until the next interrupt, unless a PCB is ready to run.
+ * The time spent halted is added to the idle cycle count.
+ */
+void cpu_idle(void);
+
+/**
+ * @brief Must be called at the start of every hardware interrupt handler, stops the idle
+ * time accounting if the interrupt woke the CPU from @code cpu_idle.
+ */
+void idle_irq_entry(void);
+
+#endif //F_R_I_D_A_Y_TIMER_H
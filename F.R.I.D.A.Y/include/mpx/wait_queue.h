@@ -0,0 +1,61 @@
+#ifndef F_R_I_D_A_Y_WAIT_QUEUE_H
+#define F_R_I_D_A_Y_WAIT_QUEUE_H
+
+#include "stdbool.h"
+#include "sync.h"
+#include "sys_req.h"
+#include "mpx/pcb.h"
+
+/**
+ * @file wait_queue.h
+ * @brief Contains the kernel side of wait queues, semaphores and mutexes.
+ * Parked PCBs are kept out of the PCB queue, so the scheduler never has to skip over them.
+ */
+
+/**
+ * @brief Parks the PCB at the end of the wait queue. The PCB must not be in the PCB queue.
+ * @param wq the wait queue.
+ * @param pcb_ptr the PCB to park.
+ */
+void wait_queue_push(wait_queue_t *wq, struct pcb *pcb_ptr);
+
+/**
+ * @brief Wakes the first PCB in the wait queue, moving it back into the PCB queue as ready.
+ * @param wq the wait queue.
+ * @return the woken PCB, or NULL if the queue was empty.
+ */
+struct pcb *wait_queue_wake(wait_queue_t *wq);
+
+/**
+ * @brief Removes the PCB from whichever wait queue it is parked in, without waking it.
+ * @param pcb_ptr the PCB.
+ * @return true if the PCB was parked and removed, false if it wasn't parked.
+ */
+bool wait_queue_unpark(struct pcb *pcb_ptr);
+
+/**
+ * @brief Iterates over every parked PCB.
+ * @param prev the previously returned PCB, or NULL to get the first one.
+ * @return the next parked PCB, or NULL if there are no more.
+ */
+struct pcb *next_parked_pcb(struct pcb *prev);
+
+/**
+ * @brief Releases every mutex the PCB holds, handing each to its first waiter. Called when the
+ * PCB is freed, so its waiters aren't parked forever.
+ * @param pcb_ptr the PCB.
+ */
+void mutex_release_all(struct pcb *pcb_ptr);
+
+/**
+ * @brief Performs a synchronisation request for the calling PCB.
+ * @param action one of the semaphore, mutex or wait queue op codes.
+ * @param object the semaphore, mutex or wait queue.
+ * @param arg the mutex to release for WQ_WAIT, otherwise unused.
+ * @param caller the calling PCB.
+ * @param ctx the caller's context, its EAX is set to the request's result.
+ * @return the wait queue the caller has to be parked in, or NULL if it can keep running.
+ */
+wait_queue_t *sync_request(op_code action, void *object, void *arg, struct pcb *caller, struct context *ctx);
+
+#endif //F_R_I_D_A_Y_WAIT_QUEUE_H
@@ -0,0 +1,102 @@
+#ifndef F_R_I_D_A_Y_SPSC_RING_H
+#define F_R_I_D_A_Y_SPSC_RING_H
+
+#include "stdbool.h"
+#include "stddef.h"
+
+/**
+ * @file spsc_ring.h
+ * @brief A byte ring buffer shared by one producer and one consumer, like an interrupt handler
+ * and a process. The indices run freely and are masked into the power of two sized buffer, so
+ * each side only ever writes its own index and neither needs interrupts turned off.
+ *
+ * That only holds while there's a single producer and a single consumer. A ring with more than
+ * one of either has to be used with interrupts off (and the kernel lock held), like any other
+ * shared buffer.
+ */
+
+///The size of a cache line, the indices are kept on separate ones so the two sides don't share one.
+#define SPSC_CACHE_LINE 64
+
+///The structure holding a single producer, single consumer ring.
+typedef struct {
+    ///The index the next byte is written to, only changed by the producer.
+    volatile unsigned int head __attribute__((aligned(SPSC_CACHE_LINE)));
+    ///The index the next byte is read from, only changed by the consumer.
+    volatile unsigned int tail __attribute__((aligned(SPSC_CACHE_LINE)));
+    ///The bytes, fixed once the ring is created.
+    char *buffer __attribute__((aligned(SPSC_CACHE_LINE)));
+    ///The capacity minus one, used to mask the indices.
+    unsigned int mask;
+} spsc_ring_t;
+
+/**
+ * @brief Allocates the ring's buffer.
+ * @param ring the ring.
+ * @param capacity the bytes it should hold, rounded up to a power of two.
+ * @return true if it was created, false if the buffer couldn't be allocated.
+ */
+bool spsc_init(spsc_ring_t *ring, size_t capacity);
+
+/**
+ * @brief Frees the ring's buffer. Neither side may be using it.
+ * @param ring the ring.
+ */
+void spsc_destroy(spsc_ring_t *ring);
+
+/**
+ * @brief Gets the amount of bytes the ring holds.
+ * @param ring the ring.
+ * @return the capacity, 0 if it was never created.
+ */
+size_t spsc_capacity(const spsc_ring_t *ring);
+
+/**
+ * @brief Gets the amount of bytes waiting to be read.
+ * @param ring the ring.
+ * @return the amount of bytes.
+ */
+size_t spsc_count(const spsc_ring_t *ring);
+
+/**
+ * @brief Gets the amount of bytes that can be written without overwriting unread ones.
+ * @param ring the ring.
+ * @return the amount of bytes.
+ */
+size_t spsc_space(const spsc_ring_t *ring);
+
+/**
+ * @brief Adds a byte to the ring. Only called by the producer.
+ * @param ring the ring.
+ * @param value the byte.
+ * @return true if it was added, false if the ring is full.
+ */
+bool spsc_push(spsc_ring_t *ring, char value);
+
+/**
+ * @brief Takes the oldest byte out of the ring. Only called by the consumer.
+ * @param ring the ring.
+ * @param value where to put the byte.
+ * @return true if there was one, false if the ring is empty.
+ */
+bool spsc_pop(spsc_ring_t *ring, char *value);
+
+/**
+ * @brief Adds as many of the bytes as fit to the ring. Only called by the producer.
+ * @param ring the ring.
+ * @param buffer the bytes.
+ * @param len the amount of bytes.
+ * @return the amount of bytes added.
+ */
+size_t spsc_write(spsc_ring_t *ring, const char *buffer, size_t len);
+
+/**
+ * @brief Takes up to len bytes out of the ring. Only called by the consumer.
+ * @param ring the ring.
+ * @param buffer where to put the bytes.
+ * @param len the most bytes to take.
+ * @return the amount of bytes taken.
+ */
+size_t spsc_read(spsc_ring_t *ring, char *buffer, size_t len);
+
+#endif //F_R_I_D_A_Y_SPSC_RING_H
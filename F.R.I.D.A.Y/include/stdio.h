@@ -7,6 +7,7 @@
 
 #include "stddef.h"
 #include "stdbool.h"
+#include "sys_req.h"
 
 /**
  * @file stdio.h
@@ -21,7 +22,8 @@ char getc(void);
 
 /**
  * @brief Polls a single ASCII character from standard input.
- * If no characters are available, 0 is returned.
+ * If no characters are available, 0 is returned. Input has to be raw and non-blocking
+ * (see @code set_raw_input), otherwise this waits for a key like @code getc.
  * @return The character polled.
  */
 char pollc(void);
@@ -40,6 +42,13 @@ char *gets(char *str_buf, size_t buf_len);
  */
 void print(const char *str);
 
+/**
+ * @brief Prints every segment to standard output with a single write, without copying them together.
+ * @param segments the segments.
+ * @param count the amount of segments.
+ */
+void printv(const io_segment_t *segments, size_t count);
+
 /**
  * @brief Prints the string with formatting to standard outpu.
  * @param str the string to print.
@@ -18,8 +18,30 @@
  */
 bool first_label_matches(const char *str1, const char *label);
 
+///The implementations of the memory and string functions.
+enum string_impl {
+    ///One byte at a time.
+    STRING_IMPL_BYTES = 0,
+    ///A whole word at a time.
+    STRING_IMPL_WORDS = 1,
+    ///REP MOVSB and REP STOSB, fastest on CPUs with ERMS. Scanning stays word at a time.
+    STRING_IMPL_REP = 2,
+};
+
+/**
+ * @brief Picks the implementation memcpy, memset, strlen and strcmp use.
+ * @param impl the implementation.
+ */
+void string_set_impl(enum string_impl impl);
+
+/**
+ * @brief Gets the implementation memcpy, memset, strlen and strcmp use.
+ * @return the implementation.
+ */
+enum string_impl string_get_impl(void);
+
 /**
- Copy a region of memory.
+ Copy a region of memory. The regions may overlap.
  @param dst The destination memory region
  @param src The source memory region
  @param n The number of bytes to copy
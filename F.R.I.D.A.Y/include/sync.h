@@ -0,0 +1,108 @@
+#ifndef F_R_I_D_A_Y_SYNC_H
+#define F_R_I_D_A_Y_SYNC_H
+
+/**
+ * @file sync.h
+ * @brief Contains blocking synchronisation primitives for processes. A process that has to wait
+ * is parked in the object's wait queue, off the PCB queue, until another process wakes it.
+ */
+
+struct pcb;
+
+///A FIFO queue of PCBs parked until some event happens.
+typedef struct wait_queue {
+    ///The first PCB parked, woken first.
+    struct pcb *head;
+    ///The last PCB parked.
+    struct pcb *tail;
+} wait_queue_t;
+
+///A counting semaphore.
+typedef struct {
+    ///The amount of available units.
+    int count;
+    ///The PCBs waiting for a unit.
+    wait_queue_t waiters;
+} semaphore_t;
+
+///A mutual exclusion lock, owned by a single PCB at a time.
+typedef struct mutex {
+    ///The PCB holding the lock, or NULL if it's free.
+    struct pcb *owner;
+    ///The PCBs waiting for the lock.
+    wait_queue_t waiters;
+    ///The next mutex held by the same PCB, so they can be released if it's deleted.
+    struct mutex *next_held;
+} mutex_t;
+
+/**
+ * @brief Initializes the wait queue as empty.
+ * @param wq the wait queue.
+ */
+void wait_queue_init(wait_queue_t *wq);
+
+/**
+ * @brief Initializes the semaphore with the given amount of units.
+ * @param sem the semaphore.
+ * @param count the initial amount of units.
+ */
+void sem_init(semaphore_t *sem, int count);
+
+/**
+ * @brief Takes a unit from the semaphore, parking the process until one is available.
+ * @param sem the semaphore.
+ * @return 0 on success, negative on error.
+ */
+int sem_wait(semaphore_t *sem);
+
+/**
+ * @brief Returns a unit to the semaphore, waking the longest waiting process if there is one.
+ * @param sem the semaphore.
+ * @return 0 on success, negative on error.
+ */
+int sem_signal(semaphore_t *sem);
+
+/**
+ * @brief Initializes the mutex as unlocked.
+ * @param mutex the mutex.
+ */
+void mutex_init(mutex_t *mutex);
+
+/**
+ * @brief Locks the mutex, parking the process until the mutex is handed to it.
+ * @param mutex the mutex.
+ * @return 0 on success, negative on error.
+ */
+int mutex_lock(mutex_t *mutex);
+
+/**
+ * @brief Unlocks the mutex, handing it directly to the longest waiting process if there is one.
+ * @param mutex the mutex, must be owned by the calling process.
+ * @return 0 on success, negative on error.
+ */
+int mutex_unlock(mutex_t *mutex);
+
+/**
+ * @brief Parks the process in the wait queue until it is notified. If a mutex is given it is
+ *        released while waiting and locked again before returning, like a condition variable.
+ * @param wq the wait queue.
+ * @param mutex the mutex to release while waiting, or NULL.
+ * @return 0 on success, negative on error.
+ */
+int wq_wait(wait_queue_t *wq, mutex_t *mutex);
+
+/**
+ * @brief Wakes the longest waiting process in the wait queue, if any.
+ * @param wq the wait queue.
+ * @return 0 on success, negative on error.
+ */
+int wq_notify(wait_queue_t *wq);
+
+/**
+ * @brief Wakes every process in the wait queue.
+ * @param wq the wait queue.
+ * @return 0 on success, negative on error.
+ */
+int wq_notify_all(wait_queue_t *wq);
+
+#endif //F_R_I_D_A_Y_SYNC_H
@@ -1,6 +1,8 @@
 #ifndef MPX_SYS_REQ_H
 #define MPX_SYS_REQ_H
 
+#include <stddef.h>
+#include <stdbool.h>
 #include <mpx/device.h>
 
 /**
@@ -12,8 +14,33 @@ typedef enum {
 	EXIT,
 	IDLE,
 	READ,
-	WRITE
+	WRITE,
+	SEM_WAIT,
+	SEM_SIGNAL,
+	MUTEX_LOCK,
+	MUTEX_UNLOCK,
+	WQ_WAIT,
+	WQ_NOTIFY,
+	WQ_NOTIFY_ALL,
+	MSG_SEND,
+	MSG_RECEIVE,
+	MSG_TRY_RECEIVE,
+	IO_RING_SETUP,
+	IO_RING_ENTER,
+	WRITEV,
+	NOOP,
+	SLEEP,
+	EDF_ADMIT,
+	EDF_WAIT
 } op_code;
+
+///A single buffer of a vectored write.
+typedef struct {
+	///The start of the buffer.
+	const char *base;
+	///The length of the buffer.
+	size_t length;
+} io_segment_t;
     
 // error codes
 #define INVALID_OPERATION	(-1)
@@ -22,10 +49,20 @@ typedef enum {
 
 /**
  Request an MPX kernel operation.
- @param op_code One of READ, WRITE, IDLE, or EXIT
- @param ... As required for READ or WRITE
+ @param op_code One of READ, WRITE, IDLE, EXIT, or a synchronisation request
+ @param ... As required for READ or WRITE, the device, segments and segment count for WRITEV, the object (and the mutex for WQ_WAIT) for synchronisation requests,
+        the receiver's name and the message for MSG_SEND, or the ring (and the
+        completions to wait for with IO_RING_ENTER) for ring requests, or the ticks for SLEEP,
+        or the period and budget (in ticks) for EDF_ADMIT
  @return Varies by operation
 */ 
 int sys_req(op_code op, ...);
+
+/**
+ Chooses how sys_req enters the kernel. The fast entry calls the system call handler
+ directly with a hand built interrupt frame, the slow one goes through int $0x60.
+ @param enabled true to use the fast entry, which is the default
+*/
+void sys_set_fast_entry(bool enabled);
  
 #endif
@@ -0,0 +1,146 @@
+#include "stddef.h"
+#include "mpx/aio.h"
+#include "mpx/serial.h"
+#include "mpx/wait_queue.h"
+
+/**
+ * @file aio.c
+ * @brief Contains the kernel side of submission/completion rings.
+ */
+
+///The mask to turn a ring index into an entry.
+#define RING_MASK (IO_RING_ENTRIES - 1)
+
+///The first registered ring.
+static io_ring_t *registered_rings = NULL;
+
+/**
+ * @brief Gets the amount of completions the owner hasn't taken yet.
+ * @param ring the ring.
+ * @return the amount of completions.
+ */
+static unsigned int ring_ready(io_ring_t *ring)
+{
+    return ring->cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Takes as many submissions from the ring as the completion queue has room for.
+ * Capping them this way means a completion never has to be dropped.
+ * @param ring the ring.
+ * @return the amount of submissions taken.
+ */
+static int ring_submit(io_ring_t *ring)
+{
+    int submitted = 0;
+    //The owner may be queuing on another CPU, the entries up to the tail are only read once it's seen.
+    unsigned int tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+    while(ring->sq_head != tail && ring_ready(ring) + ring->in_flight < IO_RING_ENTRIES)
+    {
+        io_sqe_t sqe = ring->sq[ring->sq_head & RING_MASK];
+        __atomic_store_n(&ring->sq_head, ring->sq_head + 1, __ATOMIC_RELEASE);
+        ring->in_flight++;
+        submitted++;
+
+        io_req_result result = io_submit(ring, sqe.user_data, sqe.operation, sqe.dev, sqe.buffer, sqe.length);
+        if(result == INVALID_PARAMS || result == DEVICE_CLOSED)
+            io_ring_post(ring, sqe.user_data, INVALID_OPERATION);
+    }
+    return submitted;
+}
+
+/**
+ * @brief Removes the ring from the registered rings, cancelling its operations so nothing is
+ * posted to it or done with its buffers afterwards.
+ * @param ring the ring.
+ */
+static void ring_unregister(io_ring_t *ring)
+{
+    io_cancel_ring(ring);
+    ring->in_flight = 0;
+
+    io_ring_t **link = &registered_rings;
+    while(*link != NULL && *link != ring)
+        link = &(*link)->next;
+
+    if(*link != NULL)
+        *link = ring->next;
+    ring->next = NULL;
+    ring->owner = NULL;
+}
+
+wait_queue_t *io_ring_request(op_code action, io_ring_t *ring, unsigned int min_complete, struct pcb *caller, struct context *ctx)
+{
+    if(ring == NULL || caller == NULL)
+    {
+        ctx->eax = INVALID_OPERATION;
+        return NULL;
+    }
+
+    switch (action)
+    {
+        case IO_RING_SETUP:
+        {
+            if(caller->io_ring != NULL)
+                ring_unregister(caller->io_ring);
+
+            ring->sq_head = ring->sq_tail = 0;
+            ring->cq_head = ring->cq_tail = 0;
+            ring->in_flight = ring->wanted = 0;
+            wait_queue_init(&ring->waiters);
+            ring->owner = caller;
+            ring->next = registered_rings;
+            registered_rings = ring;
+            caller->io_ring = ring;
+            return NULL;
+        }
+        case IO_RING_ENTER:
+        {
+            if(caller->io_ring != ring)
+            {
+                ctx->eax = INVALID_OPERATION;
+                return NULL;
+            }
+
+            ctx->eax = ring_submit(ring);
+
+            //Only wait for completions that can actually come.
+            unsigned int possible = ring_ready(ring) + ring->in_flight;
+            ring->wanted = min_complete < possible ? min_complete : possible;
+            if(ring_ready(ring) >= ring->wanted)
+                return NULL;
+            return &ring->waiters;
+        }
+        default:
+            ctx->eax = INVALID_OPERATION;
+            return NULL;
+    }
+}
+
+void io_ring_poll(void)
+{
+    for(io_ring_t *ring = registered_rings; ring != NULL; ring = ring->next)
+        ring_submit(ring);
+}
+
+void io_ring_post(io_ring_t *ring, int user_data, int result)
+{
+    io_cqe_t *cqe = &ring->cq[ring->cq_tail & RING_MASK];
+    cqe->user_data = user_data;
+    cqe->result = result;
+    //Publish the entry only once it's filled in, the owner may be peeking on another CPU.
+    __atomic_store_n(&ring->cq_tail, ring->cq_tail + 1, __ATOMIC_RELEASE);
+    ring->in_flight--;
+
+    if(ring->waiters.head != NULL && ring_ready(ring) >= ring->wanted)
+        wait_queue_wake(&ring->waiters);
+}
+
+void io_ring_release(struct pcb *pcb_ptr)
+{
+    if(pcb_ptr->io_ring == NULL)
+        return;
+
+    ring_unregister(pcb_ptr->io_ring);
+    pcb_ptr->io_ring = NULL;
+}
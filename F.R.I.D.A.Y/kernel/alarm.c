@@ -4,147 +4,221 @@
 #include "string.h"
 #include "mpx/clock.h"
 #include "sys_req.h"
-#include "mpx/pcb.h"
-#include "stdlib.h"
+#include "memory.h"
+#include "mpx/alarm.h"
+#include "mpx/wait_queue.h"
 
 /**
  * @file alarm.c
  * @brief Contains logic to create alarms for the OS.
  */
 
-///The parameters used to pass into the alarm function.
-typedef struct alarm_params
+///The name of the alarm dispatcher process.
+#define ALARM_DISPATCHER_NAME "alarms"
+///The initial capacity of the alarm heap.
+#define ALARM_HEAP_INITIAL_CAP 8
+///The seconds in a single day.
+#define SECONDS_PER_DAY 86400
+
+///A single pending alarm.
+typedef struct alarm
 {
-    ///A pointer to where the time is stored.
-    int *time_ptr;
-    ///A pointer to where the message is stored.
-    char *str_ptr;
-    ///The timezone used to create the alarm.
-    time_zone_t *time_zone;
-    ///The data to store.
-    unsigned char buffer[100];
-} alarm_structure;
+    ///The deadline of the alarm, in seconds since 01/01/00 UTC.
+    unsigned int deadline;
+    ///The message to display, stored directly after the alarm.
+    char message[];
+} alarm_t;
+
+///The min-heap of pending alarms, ordered by deadline.
+static alarm_t **alarm_heap = NULL;
+///The amount of alarms in the heap.
+static size_t alarm_count = 0;
+///The capacity of the heap array.
+static size_t alarm_capacity = 0;
+///The dispatcher process, or NULL if it hasn't been created yet.
+static struct pcb *dispatcher = NULL;
+///The wait queue the dispatcher parks in until the next deadline.
+static wait_queue_t dispatcher_wait = {0};
+
+///The amount of days before the start of each month, in a non leap year.
+static const unsigned int days_before_month[12] = {
+        0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
 
 /**
- * Check if the given time array of hours, minutes, seconds is after the other.
- *
- * @param now the time array considered to be 'now'
- * @param check the time to check at.
- * @return true if it is after.
+ * @brief Converts the given time array to seconds since 01/01/00.
+ * @param time the time array, in the format {year, month, date, week_day, hours, mins, seconds}.
+ * @return the amount of seconds.
  */
-bool is_time_after(const int *now, const int *check)
+static unsigned int time_to_seconds(const int *time)
 {
-    //Hours.
-    if(now[0] < check[0])
-        return false;
-    else if(now[0] > check[0])
-        return true;
+    unsigned int year = (unsigned int) time[0];
+    unsigned int month = (unsigned int) time[1];
 
-    //Minutes.
-    if(now[1] < check[1])
-        return false;
-    else if(now[1] > check[1])
-        return true;
+    //Every 4th year starting from 00 is a leap year.
+    unsigned int days = year * 365 + (year + 3) / 4;
+    days += days_before_month[(month - 1) % 12];
+    if(month > 2 && year % 4 == 0)
+        days++;
+    days += (unsigned int) time[2] - 1;
 
-    //Seconds.
-    if(now[2] < check[2])
-        return false;
-    else if(now[2] > check[2])
-        return true;
+    return days * SECONDS_PER_DAY + time[4] * 3600 + time[5] * 60 + time[6];
+}
+
+/**
+ * @brief Swaps two alarms in the heap.
+ * @param a the first index.
+ * @param b the second index.
+ */
+static void heap_swap(size_t a, size_t b)
+{
+    alarm_t *tmp = alarm_heap[a];
+    alarm_heap[a] = alarm_heap[b];
+    alarm_heap[b] = tmp;
+}
+
+/**
+ * @brief Pushes the alarm into the heap, growing it if necessary.
+ * @param alarm the alarm.
+ * @return true if it was added, false if the heap couldn't grow.
+ */
+static bool heap_push(alarm_t *alarm)
+{
+    if(alarm_count == alarm_capacity)
+    {
+        size_t new_cap = alarm_capacity == 0 ? ALARM_HEAP_INITIAL_CAP : alarm_capacity * 2;
+        alarm_t **grown = sys_alloc_mem(new_cap * sizeof(alarm_t *));
+        if(grown == NULL)
+            return false;
+
+        if(alarm_heap != NULL)
+        {
+            memcpy(grown, alarm_heap, alarm_count * sizeof(alarm_t *));
+            sys_free_mem(alarm_heap);
+        }
+        alarm_heap = grown;
+        alarm_capacity = new_cap;
+    }
+
+    //Sift the new alarm up to its place.
+    size_t index = alarm_count++;
+    alarm_heap[index] = alarm;
+    while(index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if(alarm_heap[parent]->deadline <= alarm_heap[index]->deadline)
+            break;
+
+        heap_swap(parent, index);
+        index = parent;
+    }
     return true;
 }
 
-bool shouldAlarm(const int *time_array, time_zone_t *tz)
+/**
+ * @brief Removes the earliest alarm from the heap.
+ * @return the alarm, or NULL if the heap is empty.
+ */
+static alarm_t *heap_pop(void)
 {
-    // get current time
-    int time_buf[7];
-    get_time(time_buf);
-    adj_timezone(time_buf, tz->tz_hour_offset, tz->tz_minute_offset);
-    //Check the years.
-    if(time_array[0] > time_buf[0])
-        return false;
+    if(alarm_count == 0)
+        return NULL;
 
-    //Check the month.
-    if(time_array[1] > time_buf[1])
-        return false;
+    alarm_t *top = alarm_heap[0];
+    alarm_heap[0] = alarm_heap[--alarm_count];
 
-    //Check day.
-    if(time_array[2] > time_buf[2])
-        return false;
+    //Sift the moved alarm down to its place.
+    size_t index = 0;
+    for(;;)
+    {
+        size_t smallest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if(left < alarm_count && alarm_heap[left]->deadline < alarm_heap[smallest]->deadline)
+            smallest = left;
+        if(right < alarm_count && alarm_heap[right]->deadline < alarm_heap[smallest]->deadline)
+            smallest = right;
+        if(smallest == index)
+            break;
+
+        heap_swap(index, smallest);
+        index = smallest;
+    }
+    return top;
+}
 
-    // index 4-6 is hours - seconds
-    if (time_array[4] < time_buf[4])
-        return true;
-    // printf("alarm time is %d:%d:%d current time is %d:%d:%d\n", time_array[0], time_array[1], time_array[2], time_buf[4], time_buf[5], time_buf[6]);
-    if (time_array[4] == time_buf[4] && time_array[5] < time_buf[5])
-        return true;
-    if (time_array[4] == time_buf[4] && time_array[5] == time_buf[5] && time_array[6] <= time_buf[6])
-        return true;
+/**
+ * @brief Checks if the earliest alarm has reached its deadline.
+ * @return true if an alarm should be displayed.
+ */
+static bool alarm_due(void)
+{
+    if(alarm_count == 0)
+        return false;
 
-    return false;
+    int now[7];
+    get_time(now);
+    return alarm_heap[0]->deadline <= time_to_seconds(now);
 }
 
 /**
- * @brief The alarm function used by the alarm processes.
- * @param time_array the time array to go off at.
- * @param message the message to send to the user.
- * @param time_zone the timezone to use for the alarm.
+ * @brief The dispatcher process, displays every alarm that has expired then parks until the next one.
  * @authors Kolby Eisenhauer
  */
-void alarm_function(int *time_array, const char *message, time_zone_t *time_zone)
+void alarm_dispatcher(void)
 {
-    while (!shouldAlarm(time_array, time_zone))
+    for(;;)
     {
-        sys_req(IDLE);
+        while(alarm_due())
+        {
+            alarm_t *alarm = heap_pop();
+            println(alarm->message);
+            sys_free_mem(alarm);
+        }
+
+        wq_wait(&dispatcher_wait, NULL);
     }
-
-    println(message);
-    sys_req(EXIT);
 }
 
-///The alarm count used to make sure names are unique.
-static int alarms = 0;
+void alarm_check(void)
+{
+    if(dispatcher_wait.head == NULL || !alarm_due())
+        return;
 
+    wait_queue_wake(&dispatcher_wait);
+}
 
 bool create_new_alarm(int *time_array, const char *message)
 {
-    char name[20] = {'a', 'l', 'a', 'r', 'm', '\0'};
+    //Start the dispatcher the first time an alarm is made.
+    if(dispatcher == NULL)
+    {
+        if(!generate_new_pcb(ALARM_DISPATCHER_NAME, 1, SYSTEM, &alarm_dispatcher, NULL, 0, 0))
+            return false;
+        dispatcher = pcb_find(ALARM_DISPATCHER_NAME);
+    }
 
-    //Prepare the parameters for the function.
-    alarm_structure parameters = {0};
-    parameters.str_ptr = (char *) parameters.buffer;
     size_t len = strlen(message);
-    strcpy(parameters.str_ptr, message, len);
-    parameters.time_zone = (time_zone_t *) get_clock_timezone();
+    alarm_t *alarm = sys_alloc_mem(sizeof(alarm_t) + len + 1);
+    if(alarm == NULL)
+        return false;
+    memcpy(alarm->message, message, len + 1);
 
-    int time_buf[7] = {0};
-    get_time(time_buf);
-    adj_timezone(time_buf, parameters.time_zone->tz_hour_offset, parameters.time_zone->tz_minute_offset);
+    //The given time is local, so convert the deadline back to the clock's time.
+    const time_zone_t *tz = get_clock_timezone();
+    int tz_offset = tz->tz_hour_offset * 3600 + tz->tz_minute_offset * 60;
+    alarm->deadline = time_to_seconds(time_array) - tz_offset;
 
-    //Check if we need to adjust the days.
-    if(is_time_after(time_buf + 4, time_array + 4))
+    //Times that already passed today go off tomorrow.
+    int now[7];
+    get_time(now);
+    if(alarm->deadline < time_to_seconds(now))
+        alarm->deadline += SECONDS_PER_DAY;
+
+    if(!heap_push(alarm))
     {
-        adj_timezone(time_array, 24, 0);
+        sys_free_mem(alarm);
+        return false;
     }
-
-    //Copy in the time pointer.
-    parameters.time_ptr = (int *) (parameters.buffer + len + 2);
-    memcpy(parameters.time_ptr, time_array, 7 * sizeof(int));
-
-    //Prepare the process' name.
-    size_t name_len = 15;
-    char process_name[name_len];
-    do {
-        memset(process_name, 0, name_len);
-        strcpy(process_name, name, -1);
-        char num_buf[10] = {0};
-        itoa(alarms, num_buf, 9);
-        strcpy(process_name + strlen(name), num_buf, -1);
-        alarms++;
-    }while(pcb_find(process_name) != NULL);
-
-    //Generate the actual PCB.
-    bool generated = generate_new_pcb(process_name, 1, USER, &alarm_function, (char *) &parameters, sizeof(alarm_structure), 2);
-    return generated;
+    return true;
 }
-
@@ -0,0 +1,238 @@
+#include "mpx/apic.h"
+#include "stddef.h"
+#include "mpx/cpuid.h"
+
+/**
+ * @file apic.c
+ * @brief Contains access to the local APIC of the running CPU and the IO APIC.
+ */
+
+///The software enable bit of the spurious interrupt vector register.
+#define LAPIC_SVR_ENABLE 0x100
+///The periodic mode bit of the LVT timer register.
+#define LAPIC_TIMER_PERIODIC (1 << 17)
+///The active low bit of a redirection entry.
+#define IOAPIC_ACTIVE_LOW (1 << 13)
+///The level triggered bit of a redirection entry.
+#define IOAPIC_LEVEL (1 << 15)
+///The index of the first redirection entry register.
+#define IOAPIC_REDIRECTION 0x10
+
+///The MPS flags for an active low interrupt.
+#define MPS_ACTIVE_LOW 0x3
+///The MPS flags for a level triggered interrupt, shifted.
+#define MPS_LEVEL (0x3 << 2)
+
+///The MADT entry for an IO APIC.
+#define MADT_IOAPIC 1
+///The MADT entry for an interrupt source override.
+#define MADT_OVERRIDE 2
+
+///The delivery status bit of the interrupt command register, set while the IPI is pending.
+#define LAPIC_ICR_PENDING (1 << 12)
+
+bool lapic_present(void)
+{
+    return cpu_features.apic;
+}
+
+void lapic_enable(void)
+{
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_IV);
+}
+
+uint8_t lapic_id(void)
+{
+    return (uint8_t) (lapic_read(LAPIC_ID) >> 24);
+}
+
+void lapic_send_ipi(uint8_t dest, uint32_t command)
+{
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t) dest << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+        __asm__ volatile ("pause");
+}
+
+///The header every ACPI table starts with.
+struct acpi_header {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+///The ACPI 1.0 root system description pointer.
+struct acpi_rsdp {
+    char signature[8];
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_addr;
+} __attribute__((packed));
+
+///The configuration read from the MADT.
+static struct apic_config config = {0};
+
+/**
+ * @brief Sums the bytes of an ACPI structure.
+ * @param ptr the structure.
+ * @param len the length of the structure.
+ * @return the sum, which is 0 for a valid structure.
+ */
+static uint8_t acpi_checksum(const void *ptr, uint32_t len)
+{
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; ++i)
+        sum += ((const uint8_t *) ptr)[i];
+    return sum;
+}
+
+/**
+ * @brief Checks an ACPI signature, which isn't null terminated.
+ * @param signature the signature.
+ * @param expected the expected signature.
+ * @param len the length of the signature.
+ * @return true if they match.
+ */
+static bool signature_matches(const char *signature, const char *expected, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        if (signature[i] != expected[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Looks for the RSDP in the BIOS ROM.
+ * @return the RSDP, or NULL if there is none.
+ */
+static const struct acpi_rsdp *find_rsdp(void)
+{
+    for (uint32_t addr = 0xE0000; addr < 0x100000; addr += 16)
+    {
+        const struct acpi_rsdp *rsdp = (const struct acpi_rsdp *) addr;
+        if (signature_matches(rsdp->signature, "RSD PTR ", 8) && acpi_checksum(rsdp, sizeof(*rsdp)) == 0)
+            return rsdp;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the MADT in the RSDT.
+ * @return the MADT, or NULL if there is none.
+ */
+static const struct acpi_header *find_madt(void)
+{
+    const struct acpi_rsdp *rsdp = find_rsdp();
+    if (rsdp == NULL)
+        return NULL;
+
+    const struct acpi_header *rsdt = (const struct acpi_header *) rsdp->rsdt_addr;
+    if (!signature_matches(rsdt->signature, "RSDT", 4) || acpi_checksum(rsdt, rsdt->length) != 0)
+        return NULL;
+
+    const uint32_t *tables = (const uint32_t *) (rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(*rsdt)) / 4;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const struct acpi_header *table = (const struct acpi_header *) tables[i];
+        if (signature_matches(table->signature, "APIC", 4) && acpi_checksum(table, table->length) == 0)
+            return table;
+    }
+    return NULL;
+}
+
+bool apic_detect(void)
+{
+    if (!lapic_present())
+        return false;
+
+    const struct acpi_header *madt = find_madt();
+    if (madt == NULL)
+        return false;
+
+    //The local APIC address comes right after the header, followed by the flags.
+    const uint8_t *bytes = (const uint8_t *) madt;
+    if (*(const uint32_t *) (bytes + sizeof(*madt)) != LAPIC_BASE)
+        return false;
+
+    //ISA interrupts map to the same global system interrupt unless they're overridden.
+    for (int irq = 0; irq < ISA_IRQS; ++irq)
+    {
+        config.irq_gsi[irq] = irq;
+        config.irq_flags[irq] = 0;
+    }
+
+    bool ioapic_found = false;
+    for (uint32_t offset = sizeof(*madt) + 8; offset + 2 <= madt->length; offset += bytes[offset + 1])
+    {
+        const uint8_t *entry = bytes + offset;
+        if (entry[1] < 2)
+            break;
+
+        if (entry[0] == MADT_IOAPIC)
+        {
+            uint32_t addr = *(const uint32_t *) (entry + 4);
+            uint32_t gsi_base = *(const uint32_t *) (entry + 8);
+
+            //Only the IO APIC that handles the ISA interrupts is used.
+            if (gsi_base == 0)
+            {
+                config.ioapic_addr = addr;
+                config.gsi_base = gsi_base;
+                ioapic_found = true;
+            }
+        }
+        else if (entry[0] == MADT_OVERRIDE && entry[3] < ISA_IRQS)
+        {
+            config.irq_gsi[entry[3]] = *(const uint32_t *) (entry + 4);
+            config.irq_flags[entry[3]] = *(const uint16_t *) (entry + 8);
+        }
+    }
+
+    config.found = ioapic_found && config.ioapic_addr == IOAPIC_BASE;
+    return config.found;
+}
+
+const struct apic_config *apic_get_config(void)
+{
+    return &config;
+}
+
+void ioapic_route(int irq, uint8_t vector, bool enabled)
+{
+    uint32_t pin = config.irq_gsi[irq] - config.gsi_base;
+    uint16_t flags = config.irq_flags[irq];
+
+    uint32_t low = vector;
+    if ((flags & MPS_ACTIVE_LOW) == MPS_ACTIVE_LOW)
+        low |= IOAPIC_ACTIVE_LOW;
+    if ((flags & MPS_LEVEL) == MPS_LEVEL)
+        low |= IOAPIC_LEVEL;
+    if (!enabled)
+        low |= APIC_MASKED;
+
+    ioapic_write(IOAPIC_REDIRECTION + pin * 2 + 1, (uint32_t) lapic_id() << 24);
+    ioapic_write(IOAPIC_REDIRECTION + pin * 2, low);
+}
+
+void lapic_timer_start(uint8_t vector, uint32_t count)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+    lapic_write(LAPIC_TIMER_LVT, vector | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INITIAL, count);
+}
+
+void lapic_timer_stop(void)
+{
+    lapic_write(LAPIC_TIMER_LVT, APIC_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+}
@@ -42,7 +42,16 @@ bool (*comm_funcs[])(const char *comm) = {
         &cmd_show_allocate,
         &cmd_show_free,
         &cmd_dragonmaze,
-        &cmd_minesweeper
+        &cmd_minesweeper,
+        &cmd_uptime,
+        &cmd_sysbench,
+        &cmd_top,
+        &cmd_sched,
+        &cmd_irqstat,
+        &cmd_strbench,
+        &cmd_uart,
+        &cmd_serial,
+        &cmd_devstat
 };
 
 /// Used to denote if the comm hand should stop.
@@ -95,6 +104,15 @@ void print_welcome(void)
     println("=> show-free");
     println("=> dragonmaze");
     println("=> minesweeper");
+    println("=> uptime");
+    println("=> sysbench");
+    println("=> top");
+    println("=> sched");
+    println("=> irqstat");
+    println("=> strbench");
+    println("=> uart");
+    println("=> serial");
+    println("=> devstat");
 }
 
 void comhand(void)
@@ -284,6 +284,15 @@ typedef struct {
 	uint32_t tables_phys[1024];
 } page_dir;
 
+// present, writeable, write-through and cache disabled
+#define PAGE_MMIO_FLAGS	0x1B
+
+// the memory mapped device pages, outside of the frame bitmap
+static const uint32_t mmio_pages[] = {
+	0xFEC00000,	// IO APIC
+	0xFEE00000,	// local APIC
+};
+
 // bitmap of frames
 static uint32_t frames[NFRAMES / FRAME_BIT] = { 0 };
 
@@ -424,6 +433,13 @@ void vm_init(void)
 		get_page(i, kdir, 1);
 	}
 
+	// identity map the IO APIC and local APIC registers, uncached
+	// their page table is made here so it's covered by the identity mapping below
+	for (uint32_t i = 0; i < sizeof(mmio_pages) / sizeof(mmio_pages[0]); i++) {
+		page_entry *page = get_page(mmio_pages[i], kdir, 1);
+		*(uint32_t *) page = mmio_pages[i] | PAGE_MMIO_FLAGS;
+	}
+
 	// perform identity mapping of used memory
 	// note: placement_addr gets incremented in get_page,
 	// so we're mapping the first frames as well
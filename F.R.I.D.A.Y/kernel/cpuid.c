@@ -0,0 +1,93 @@
+#include "mpx/cpuid.h"
+#include "string.h"
+
+/**
+ * @file cpuid.c
+ * @brief Contains the CPU feature probing.
+ */
+
+///Leaf 1 EDX: 4MB pages.
+#define CPUID_1_EDX_PSE (1 << 3)
+///Leaf 1 EDX: local APIC.
+#define CPUID_1_EDX_APIC (1 << 9)
+///Leaf 1 EDX: FXSAVE and FXRSTOR.
+#define CPUID_1_EDX_FXSR (1 << 24)
+///Leaf 1 EDX: SSE.
+#define CPUID_1_EDX_SSE (1 << 25)
+///Leaf 1 EDX: SSE2.
+#define CPUID_1_EDX_SSE2 (1 << 26)
+///Leaf 7 EBX: enhanced REP MOVSB/STOSB.
+#define CPUID_7_EBX_ERMS (1 << 9)
+///Leaf 0x80000007 EDX: invariant TSC.
+#define CPUID_EXT7_EDX_INVARIANT_TSC (1 << 8)
+
+struct cpu_features cpu_features = {0};
+
+void cpuid_detect(void)
+{
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int max_leaf = regs[0];
+
+    //The vendor string is spread over EBX, EDX then ECX.
+    memcpy(cpu_features.vendor, &regs[1], 4);
+    memcpy(cpu_features.vendor + 4, &regs[3], 4);
+    memcpy(cpu_features.vendor + 8, &regs[2], 4);
+    cpu_features.vendor[12] = '\0';
+
+    if (max_leaf >= 1)
+    {
+        cpuid(1, 0, regs);
+        cpu_features.pse = (regs[3] & CPUID_1_EDX_PSE) != 0;
+        cpu_features.apic = (regs[3] & CPUID_1_EDX_APIC) != 0;
+        cpu_features.fxsr = (regs[3] & CPUID_1_EDX_FXSR) != 0;
+        cpu_features.sse = (regs[3] & CPUID_1_EDX_SSE) != 0;
+        cpu_features.sse2 = (regs[3] & CPUID_1_EDX_SSE2) != 0;
+    }
+
+    if (max_leaf >= 7)
+    {
+        cpuid(7, 0, regs);
+        cpu_features.erms = (regs[1] & CPUID_7_EBX_ERMS) != 0;
+    }
+
+    cpuid(0x80000000, 0, regs);
+    if (regs[0] >= 0x80000007)
+    {
+        cpuid(0x80000007, 0, regs);
+        cpu_features.invariant_tsc = (regs[3] & CPUID_EXT7_EDX_INVARIANT_TSC) != 0;
+    }
+
+    //REP MOVSB/STOSB is only worth it with ERMS, otherwise whole words are moved at a time.
+    string_set_impl(cpu_features.erms ? STRING_IMPL_REP : STRING_IMPL_WORDS);
+}
+
+/**
+ * @brief Appends the feature's name to the description if it's present.
+ * @param buf the description.
+ * @param len the length of the buffer.
+ * @param present if the feature is present.
+ * @param name the name of the feature.
+ */
+static void describe_feature(char *buf, size_t len, bool present, const char *name)
+{
+    size_t used = strlen(buf);
+    size_t name_len = strlen(name);
+    if (!present || used + name_len + 2 > len)
+        return;
+
+    buf[used] = ' ';
+    memcpy(buf + used + 1, name, name_len + 1);
+}
+
+void cpuid_describe(char *buf, size_t len)
+{
+    sprintf("%s:", buf, len, cpu_features.vendor);
+    describe_feature(buf, len, cpu_features.erms, "ERMS");
+    describe_feature(buf, len, cpu_features.sse, "SSE");
+    describe_feature(buf, len, cpu_features.sse2, "SSE2");
+    describe_feature(buf, len, cpu_features.fxsr, "FXSR");
+    describe_feature(buf, len, cpu_features.pse, "PSE");
+    describe_feature(buf, len, cpu_features.apic, "APIC");
+    describe_feature(buf, len, cpu_features.invariant_tsc, "invariant-TSC");
+}
@@ -0,0 +1,206 @@
+#include "mpx/fpu.h"
+#include "mpx/sys_call.h"
+#include "mpx/interrupts.h"
+#include "mpx/panic.h"
+#include "memory.h"
+#include "stdint.h"
+#include "mpx/cpuid.h"
+#include "mpx/smp.h"
+
+/**
+ * @file fpu.c
+ * @brief Contains the lazy switching of the x87 and SSE registers.
+ */
+
+///The #NM (device not available) vector.
+#define NM_IV 0x07
+///CR0's monitor coprocessor bit.
+#define CR0_MP (1 << 1)
+///CR0's emulation bit.
+#define CR0_EM (1 << 2)
+///CR0's task switched bit.
+#define CR0_TS (1 << 3)
+///CR0's native FPU error bit.
+#define CR0_NE (1 << 5)
+///CR4's FXSAVE and SSE enable bit.
+#define CR4_OSFXSR (1 << 9)
+///CR4's unmasked SSE exception bit.
+#define CR4_OSXMMEXCPT (1 << 10)
+///The MXCSR value after reset, every exception masked.
+#define MXCSR_DEFAULT 0x1F80
+
+extern void fpu_nm_isr(void *);
+
+///The PCB whose state is in each CPU's registers, or NULL.
+static struct pcb *owner[SMP_MAX_CPUS] = {0};
+///If each CPU's CR0.TS is currently set.
+static bool ts_set[SMP_MAX_CPUS] = {0};
+///If FXSAVE and SSE can be used, otherwise only the x87 state is kept with FNSAVE.
+static bool use_fxsr = false;
+///The amount of times the registers moved to another PCB.
+static unsigned int switches = 0;
+
+/**
+ * @brief Sets CR0.TS, so the next FPU instruction faults.
+ */
+static void set_ts(void)
+{
+    uint32_t cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile ("mov %0, %%cr0" :: "r"(cr0 | CR0_TS));
+    ts_set[smp_cpu_index()] = true;
+}
+
+/**
+ * @brief Clears CR0.TS.
+ */
+static void clear_ts(void)
+{
+    __asm__ volatile ("clts");
+    ts_set[smp_cpu_index()] = false;
+}
+
+/**
+ * @brief Saves the registers into the PCB's save area.
+ * @param pcb_ptr the PCB.
+ */
+static void save_state(struct pcb *pcb_ptr)
+{
+    if (use_fxsr)
+        __asm__ volatile ("fxsave (%0)" :: "r"(pcb_ptr->fpu_state) : "memory");
+    else
+        __asm__ volatile ("fnsave (%0)" :: "r"(pcb_ptr->fpu_state) : "memory");
+}
+
+void fpu_init(void)
+{
+    //MXCSR (and LDMXCSR) only exist with SSE, which FXSR alone doesn't promise.
+    use_fxsr = cpu_features.fxsr && cpu_features.sse;
+    fpu_init_cpu();
+    idt_install(NM_IV, fpu_nm_isr);
+}
+
+void fpu_init_cpu(void)
+{
+    uint32_t cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP | CR0_NE;
+    __asm__ volatile ("mov %0, %%cr0" :: "r"(cr0));
+
+    if (use_fxsr)
+    {
+        uint32_t cr4;
+        __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+        __asm__ volatile ("mov %0, %%cr4" :: "r"(cr4 | CR4_OSFXSR | CR4_OSXMMEXCPT));
+    }
+
+    __asm__ volatile ("fninit");
+    set_ts();
+}
+
+void fpu_switch(struct pcb *next)
+{
+    int cpu = smp_cpu_index();
+
+    //Another CPU may pick the outgoing PCB up, so its registers can't be left behind in this one.
+    if (smp_running() && owner[cpu] != NULL && owner[cpu] != next)
+    {
+        if (ts_set[cpu])
+            clear_ts();
+        save_state(owner[cpu]);
+        owner[cpu] = NULL;
+    }
+
+    if (next == owner[cpu])
+    {
+        if (ts_set[cpu])
+            clear_ts();
+    }
+    else if (!ts_set[cpu])
+    {
+        set_ts();
+    }
+}
+
+/**
+ * @brief Gives the PCB a save area holding the registers' reset state.
+ * @param pcb_ptr the PCB.
+ */
+static void fpu_alloc_state(struct pcb *pcb_ptr)
+{
+    pcb_ptr->fpu_alloc = sys_alloc_mem(FPU_STATE_SIZE + FPU_STATE_ALIGN);
+    if (pcb_ptr->fpu_alloc == NULL)
+        kpanic("No memory left for a process's FPU state");
+
+    uintptr_t aligned = ((uintptr_t) pcb_ptr->fpu_alloc + FPU_STATE_ALIGN - 1) & ~(FPU_STATE_ALIGN - 1);
+    pcb_ptr->fpu_state = (void *) aligned;
+}
+
+/**
+ * @brief The C half of the #NM handler, moves the registers to the running PCB.
+ */
+void fpu_nm_intern(void)
+{
+    kernel_lock();
+    clear_ts();
+
+    int cpu = smp_cpu_index();
+    struct pcb *active = get_active_pcb();
+    if (active == owner[cpu])
+    {
+        kernel_unlock();
+        return;
+    }
+
+    if (owner[cpu] != NULL)
+        save_state(owner[cpu]);
+
+    owner[cpu] = active;
+    switches++;
+
+    //Nothing is running yet, so there's nothing to keep.
+    if (active == NULL)
+    {
+        __asm__ volatile ("fninit");
+        kernel_unlock();
+        return;
+    }
+
+    if (active->fpu_state == NULL)
+    {
+        fpu_alloc_state(active);
+        __asm__ volatile ("fninit");
+        if (use_fxsr)
+        {
+            uint32_t mxcsr = MXCSR_DEFAULT;
+            __asm__ volatile ("ldmxcsr %0" :: "m"(mxcsr));
+        }
+        kernel_unlock();
+        return;
+    }
+
+    if (use_fxsr)
+        __asm__ volatile ("fxrstor (%0)" :: "r"(active->fpu_state) : "memory");
+    else
+        __asm__ volatile ("frstor (%0)" :: "r"(active->fpu_state) : "memory");
+    kernel_unlock();
+}
+
+void fpu_release(struct pcb *pcb_ptr)
+{
+    for (int i = 0; i < SMP_MAX_CPUS; ++i)
+    {
+        if (owner[i] == pcb_ptr)
+            owner[i] = NULL;
+    }
+
+    if (pcb_ptr->fpu_alloc != NULL)
+        sys_free_mem(pcb_ptr->fpu_alloc);
+    pcb_ptr->fpu_alloc = NULL;
+    pcb_ptr->fpu_state = NULL;
+}
+
+unsigned int fpu_get_switches(void)
+{
+    return switches;
+}
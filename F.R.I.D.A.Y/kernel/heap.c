@@ -7,6 +7,9 @@
 #include "mpx/vm.h"
 #include "stdbool.h"
 #include "stdio.h"
+#include "mpx/sys_call.h"
+#include "mpx/smp.h"
+#include "mpx/interrupts.h"
 
 /**
  * @file heap.c
@@ -24,6 +27,8 @@ typedef struct mem_block {
     int start_address;
     ///The size of this block
     size_t size;
+    ///The PCB that allocated this block, or NULL.
+    struct pcb *owner;
 } mem_block_t;
 
 ///The beginning of the free list of memory blocks.
@@ -188,7 +193,26 @@ void insert_block(mem_block_t *mblock, bool list)
         mblock->next->prev = mblock;
 }
 
-void *allocate_memory(size_t size)
+/**
+ * Records the running PCB as the owner of the newly allocated block.
+ *
+ * @param block the block.
+ * @return the address of the block's memory.
+ */
+static void *claim_block(mem_block_t *block)
+{
+    block->owner = get_active_pcb();
+    if(block->owner != NULL)
+        block->owner->stats.heap_bytes += block->size;
+    return (void *) block->start_address;
+}
+
+/**
+ * @brief Allocates memory from the free list, with the kernel lock held.
+ * @param size the size of the memory.
+ * @return the memory, or NULL if no block is large enough.
+ */
+static void *allocate_locked(size_t size)
 {
     if(size <= 0)
         return NULL;
@@ -213,7 +237,7 @@ void *allocate_memory(size_t size)
     {
         rem_mcb_free(walk);
         insert_block(walk, false);
-        return (void *) walk->start_address;
+        return claim_block(walk);
     }
 
     // start an extra free block to be used as a remainder
@@ -222,6 +246,7 @@ void *allocate_memory(size_t size)
     extra_free_block->size = walk->size - size - sizeof(struct mem_block);
     // find new start address in extra free block
     extra_free_block->start_address = (int) ((int) extra_free_block + sizeof (mem_block_t));
+    extra_free_block->owner = NULL;
 
     // add the extra free block back to the free list
     insert_block(extra_free_block, true);
@@ -233,7 +258,7 @@ void *allocate_memory(size_t size)
     // add walk to the alloc list
     insert_block(walk, false);
     //return a pointer to the new starting address
-    return (void *) walk->start_address;
+    return claim_block(walk);
 }
 
 void initialize_heap(size_t size)
@@ -245,6 +270,7 @@ void initialize_heap(size_t size)
     //Initialize the values of the block.
     block->size = size - sizeof (mem_block_t);
     block->start_address = (int) (((int) block) + sizeof (mem_block_t));
+    block->owner = NULL;
 }
 
 /**
@@ -265,13 +291,70 @@ bool block_exists(void * mcb_address)
     return false;
 }
 
-int free_memory(void * free){
+void *allocate_memory(size_t size)
+{
+    //User processes on any CPU allocate directly, outside of a system call.
+    unsigned int flags = irq_save();
+    kernel_lock();
+    void *allocated = allocate_locked(size);
+    kernel_unlock();
+    irq_restore(flags);
+    return allocated;
+}
+
+/**
+ * @brief Frees memory back to the free list, with the kernel lock held.
+ * @param free the memory.
+ * @return 0 on success, -1 if the memory wasn't allocated.
+ */
+static int free_locked(void * free){
     void * mcb_address =  (free - sizeof(struct mem_block));
     if(!block_exists(mcb_address)) return -1;
 
+    heap_set_owner(free, NULL);
     rem_mcb_free((mem_block_t *) mcb_address);
     insert_block((mem_block_t *) mcb_address, true);
     merge_blocks((mem_block_t *) mcb_address);
 
     return 0;
-}
\ No newline at end of file
+}
+
+int free_memory(void * free){
+    unsigned int flags = irq_save();
+    kernel_lock();
+    int result = free_locked(free);
+    kernel_unlock();
+    irq_restore(flags);
+    return result;
+}
+
+size_t heap_block_size(void *pointer)
+{
+    mem_block_t *block = (mem_block_t *) (pointer - sizeof(struct mem_block));
+    return block_exists(block) ? block->size : 0;
+}
+
+bool heap_set_owner(void *pointer, struct pcb *owner)
+{
+    //Anything else would have its memory written through as if it were a block.
+    mem_block_t *block = (mem_block_t *) (pointer - sizeof(struct mem_block));
+    if(!block_exists(block))
+        return false;
+
+    if(block->owner != NULL)
+        block->owner->stats.heap_bytes -= block->size;
+
+    block->owner = owner;
+    if(owner != NULL)
+        owner->stats.heap_bytes += block->size;
+    return true;
+}
+
+void heap_disown(struct pcb *owner)
+{
+    for(mem_block_t *walk = alloc_list; walk != NULL; walk = walk->next)
+    {
+        if(walk->owner == owner)
+            walk->owner = NULL;
+    }
+}
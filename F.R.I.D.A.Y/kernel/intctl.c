@@ -0,0 +1,182 @@
+#include "mpx/intctl.h"
+#include "mpx/apic.h"
+#include "mpx/io.h"
+#include "mpx/interrupts.h"
+#include "mpx/timer.h"
+
+/**
+ * @file intctl.c
+ * @brief Contains the switch between the 8259 PIC and the APIC.
+ */
+
+///The command port of the master PIC.
+#define PIC1_COMMAND 0x20
+///The data port of the master PIC.
+#define PIC1_DATA 0x21
+///The command port of the slave PIC.
+#define PIC2_COMMAND 0xA0
+///The data port of the slave PIC.
+#define PIC2_DATA 0xA1
+///The non specific EOI command.
+#define PIC_EOI 0x20
+///The master PIC line the slave is cascaded on.
+#define PIC_CASCADE_IRQ 2
+///The vector of IRQ 0.
+#define IRQ_BASE_IV 0x20
+///The ticks the local APIC timer is measured over.
+#define CALIBRATE_TICKS 5
+
+extern void spurious_isr(void *);
+
+///The interrupt controller in use.
+static enum intctl_mode mode = INTCTL_PIC;
+///The enabled ISA interrupts, one bit each.
+static unsigned int enabled_irqs = 0;
+///The local APIC timer counts in a tick, or 0 if it hasn't been calibrated.
+static unsigned int lapic_tick_count = 0;
+///The interrupt timing, for each mode.
+static struct intctl_stats stats[2] = {0};
+
+/**
+ * @brief Writes the PIC masks for the enabled interrupts, or masks everything.
+ * @param all true to mask every interrupt.
+ */
+static void pic_write_masks(bool all)
+{
+    unsigned int unmasked = all ? 0 : enabled_irqs;
+    if (unmasked & 0xFF00)
+        unmasked |= 1 << PIC_CASCADE_IRQ;
+
+    outb(PIC1_DATA, ~unmasked & 0xFF);
+    outb(PIC2_DATA, (~unmasked >> 8) & 0xFF);
+}
+
+/**
+ * @brief Routes the enabled interrupts through the IO APIC, or masks everything.
+ * IRQ 0 stays masked, the local APIC timer drives the tick instead of the PIT.
+ * @param all true to mask every interrupt.
+ */
+static void ioapic_write_routes(bool all)
+{
+    for (int irq = 0; irq < ISA_IRQS; ++irq)
+    {
+        bool enabled = !all && irq != 0 && (enabled_irqs & (1 << irq));
+        ioapic_route(irq, IRQ_BASE_IV + irq, enabled);
+    }
+}
+
+/**
+ * @brief Measures the local APIC timer counts in a tick of the PIT.
+ * @return the counts.
+ */
+static unsigned int calibrate_lapic_timer(void)
+{
+    //Start on a tick boundary.
+    unsigned int start = get_ticks();
+    while (get_ticks() == start)
+        __asm__ volatile ("pause");
+
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+    lapic_write(LAPIC_TIMER_LVT, APIC_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+
+    start = get_ticks();
+    while (get_ticks() - start < CALIBRATE_TICKS)
+        __asm__ volatile ("pause");
+
+    unsigned int elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_timer_stop();
+    return elapsed / CALIBRATE_TICKS;
+}
+
+enum intctl_mode intctl_init(void)
+{
+    if (!apic_get_config()->found)
+        return mode;
+
+    //Spurious interrupts don't need an EOI, so they just return.
+    idt_install(LAPIC_SPURIOUS_IV, spurious_isr);
+    lapic_enable();
+    lapic_tick_count = calibrate_lapic_timer();
+    if (lapic_tick_count != 0)
+        intctl_set_mode(INTCTL_APIC);
+    return mode;
+}
+
+bool intctl_set_mode(enum intctl_mode new_mode)
+{
+    if (new_mode == INTCTL_APIC && lapic_tick_count == 0)
+        return false;
+    if (new_mode == mode)
+        return true;
+
+    unsigned int flags = irq_save();
+    if (new_mode == INTCTL_APIC)
+    {
+        pic_write_masks(true);
+        ioapic_write_routes(false);
+        lapic_timer_start(IRQ_BASE_IV, lapic_tick_count);
+    }
+    else
+    {
+        lapic_timer_stop();
+        ioapic_write_routes(true);
+        pic_write_masks(false);
+    }
+    mode = new_mode;
+    irq_restore(flags);
+    return true;
+}
+
+enum intctl_mode intctl_get_mode(void)
+{
+    return mode;
+}
+
+void intctl_enable_irq(int irq)
+{
+    unsigned int flags = irq_save();
+    enabled_irqs |= 1 << irq;
+    if (mode == INTCTL_APIC)
+        ioapic_write_routes(false);
+    else
+        pic_write_masks(false);
+    irq_restore(flags);
+}
+
+void intctl_disable_irq(int irq)
+{
+    unsigned int flags = irq_save();
+    enabled_irqs &= ~(1 << irq);
+    if (mode == INTCTL_APIC)
+        ioapic_write_routes(false);
+    else
+        pic_write_masks(false);
+    irq_restore(flags);
+}
+
+void intctl_eoi(int irq, unsigned long long entered_at)
+{
+    unsigned long long eoi_start = rdtsc();
+    if (mode == INTCTL_APIC)
+    {
+        lapic_write(LAPIC_EOI, 0);
+    }
+    else
+    {
+        if (irq >= 8)
+            outb(PIC2_COMMAND, PIC_EOI);
+        outb(PIC1_COMMAND, PIC_EOI);
+    }
+    unsigned long long now = rdtsc();
+
+    struct intctl_stats *mode_stats = &stats[mode];
+    mode_stats->count++;
+    mode_stats->eoi_cycles += now - eoi_start;
+    mode_stats->handler_cycles += now - entered_at;
+}
+
+const struct intctl_stats *intctl_get_stats(enum intctl_mode which)
+{
+    return &stats[which];
+}
@@ -0,0 +1,101 @@
+#include "stddef.h"
+#include "string.h"
+#include "memory.h"
+#include "mpx/ipc.h"
+#include "mpx/wait_queue.h"
+#include "mpx/heap.h"
+
+/**
+ * @file ipc.c
+ * @brief Contains the kernel side of process mailboxes. Messages are only ever linked and
+ * unlinked here, their data is never copied.
+ */
+
+/**
+ * @brief Takes the oldest message out of the mailbox.
+ * @param mailbox the mailbox.
+ * @return the message, or NULL if the mailbox is empty.
+ */
+static message_t *mailbox_poll(mailbox_t *mailbox)
+{
+    message_t *msg = mailbox->head;
+    if(msg == NULL)
+        return NULL;
+
+    mailbox->head = msg->next;
+    if(mailbox->head == NULL)
+        mailbox->tail = NULL;
+    msg->next = NULL;
+    return msg;
+}
+
+wait_queue_t *mailbox_request(op_code action, const char *to, message_t *msg, struct pcb *caller, struct context *ctx)
+{
+    if(caller == NULL)
+    {
+        ctx->eax = INVALID_OPERATION;
+        return NULL;
+    }
+
+    switch (action)
+    {
+        case MSG_SEND:
+        {
+            //Only a heap allocation big enough for the message can be handed over.
+            struct pcb *target = pcb_find_any(to);
+            if(target == NULL || msg == NULL || heap_block_size(msg) < sizeof(message_t))
+            {
+                ctx->eax = INVALID_OPERATION;
+                return NULL;
+            }
+
+            size_t name_len = strlen(caller->name);
+            if(name_len > MESSAGE_SENDER_LEN)
+                name_len = MESSAGE_SENDER_LEN;
+            memcpy(msg->sender, caller->name, name_len);
+            msg->sender[name_len] = '\0';
+
+            //The buffer now belongs to the receiver.
+            heap_set_owner(msg, target);
+
+            //A waiting receiver gets the message as the return value of its receive.
+            mailbox_t *mailbox = &target->mailbox;
+            if(mailbox->receivers.head != NULL)
+            {
+                ((struct context *) target->stack_ptr)->eax = (int) msg;
+                wait_queue_wake(&mailbox->receivers);
+                return NULL;
+            }
+
+            msg->next = NULL;
+            if(mailbox->tail == NULL)
+                mailbox->head = msg;
+            else
+                mailbox->tail->next = msg;
+            mailbox->tail = msg;
+            return NULL;
+        }
+        case MSG_RECEIVE:
+        {
+            message_t *received = mailbox_poll(&caller->mailbox);
+            if(received == NULL)
+                return &caller->mailbox.receivers;
+
+            ctx->eax = (int) received;
+            return NULL;
+        }
+        case MSG_TRY_RECEIVE:
+            ctx->eax = (int) mailbox_poll(&caller->mailbox);
+            return NULL;
+        default:
+            ctx->eax = INVALID_OPERATION;
+            return NULL;
+    }
+}
+
+void mailbox_clear(struct pcb *pcb_ptr)
+{
+    message_t *msg;
+    while((msg = mailbox_poll(&pcb_ptr->mailbox)) != NULL)
+        sys_free_mem(msg);
+}
@@ -1,5 +1,7 @@
 bits 32
-global rtc_isr, sys_call_isr, serial_isr
+global rtc_isr, sys_call_isr, serial_isr, timer_isr, spurious_isr, fpu_nm_isr, smp_wake_isr
+
+extern kernel_exit		; Keeps or releases the kernel lock for the context being resumed
 
 ; RTC interrupt handler
 ; Tells the slave PIC to ignore interrupts from the RTC
@@ -32,20 +34,98 @@ sys_call_isr:
     push eax
 	call sys_call       ; Call the sys_call C function to
 	mov ESP, EAX        ; Switch contexts to the return value
+	call kernel_exit    ; Only now can another CPU resume the context that was left
 	pop gs
 	pop fs
 	pop es
 	pop ds
 	pop ss
-	popa
-	mov eax, 0          ; Move 0 into the EAX register to return 0.
+	popa                ; EAX holds the return value sys_call stored in the context.
 	sti                 ; Set the interrupts.
 	iret
 
 extern serial_isr_intern
-;;; Serial port ISR. To be implemented in Module R6
+;;; Serial port ISR. Saves a full context so the handler can switch
+;;; to a process whose IO just completed.
 serial_isr:
     cli
-    call serial_isr_intern
+    pusha
+    push ss
+    push ds
+    push es
+    push fs
+    push gs
+    push esp
+    call serial_isr_intern ; Returns the context to resume.
+    mov ESP, EAX
+    call kernel_exit
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    pop ss
+    popa
+    sti
+	iret
+
+extern timer_isr_intern
+;;; PIT (IRQ 0) handler for the system tick. Saves a full context
+;;; so a halted idle process can be switched away from.
+timer_isr:
+    cli
+    pusha
+    push ss
+    push ds
+    push es
+    push fs
+    push gs
+    push esp
+    call timer_isr_intern ; Returns the context to resume.
+    mov ESP, EAX
+    call kernel_exit
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    pop ss
+    popa
+    sti
+	iret
+
+extern smp_wake_intern
+;;; Wake up IPI handler. Sent to an idle CPU when a process it
+;;; can run becomes ready, switches straight to that process.
+smp_wake_isr:
+    cli
+    pusha
+    push ss
+    push ds
+    push es
+    push fs
+    push gs
+    push esp
+    call smp_wake_intern ; Returns the context to resume.
+    mov ESP, EAX
+    call kernel_exit
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    pop ss
+    popa
     sti
 	iret
+
+;;; Local APIC spurious interrupt handler. These aren't real interrupts,
+;;; so there's nothing to acknowledge.
+spurious_isr:
+	iret
+
+extern fpu_nm_intern
+;;; Device not available (#NM) handler. Raised by the first FPU or SSE
+;;; instruction after a switch, moves the registers to the running process.
+fpu_nm_isr:
+    pusha
+    call fpu_nm_intern
+    popa
+    iret
@@ -22,6 +22,13 @@
 #include "processes.h"
 #include <memory.h>
 #include "mpx/comhand.h"
+#include "mpx/sys_call.h"
+#include "mpx/timer.h"
+#include "mpx/smp.h"
+#include "mpx/apic.h"
+#include "mpx/intctl.h"
+#include "mpx/fpu.h"
+#include "mpx/cpuid.h"
 #include "stdlib.h"
 
 
@@ -44,6 +51,13 @@ void kmain(void)
 	serial_init(COM2);
 	klogv(COM1, "Initialized serial I/O on COM1 device...");
 
+	// The CPU's features pick the string functions, and tell the later steps what's there.
+	klogv(COM1, "Probing CPU features...");
+	cpuid_detect();
+	char features[96] = {0};
+	cpuid_describe(features, sizeof(features));
+	klogv(COM1, features);
+
 	// 1) Global Descriptor Table -- mpx/gdt.h
 	// Keeps track of the various memory segments (Code, Data, Stack, etc.) required by the
 	// x86 architecture.
@@ -72,6 +86,9 @@ void kmain(void)
 	klogv(COM1, "Initializing Programmble Interrupt Controller...");
 	pic_init();
 
+	// The IO APIC is found through ACPI, whose tables are only reachable before paging is on.
+	apic_detect();
+
 	// 6) Reenable interrupts -- mpx/interrupts.h
 	// Now that interrupt routines are set up, allow interrupts to happen again.
 	klogv(COM1, "Enabling Interrupts...");
@@ -84,14 +101,29 @@ void kmain(void)
 	klogv(COM1, "Initializing virtual memory...");
 	vm_init();
 
-    serial_open(COM1, 19200);
-    serial_open(COM2, 19200);
+	// The FPU and SSE registers are only saved for processes that use them, see mpx/fpu.h.
+	klogv(COM1, "Enabling lazy FPU switching...");
+	fpu_init();
+
+    serial_open(COM1, SERIAL_DEFAULT_BAUD, SERIAL_RX_RING_DEFAULT, SERIAL_TX_RING_DEFAULT);
+    serial_open(COM2, SERIAL_DEFAULT_BAUD, SERIAL_RX_RING_DEFAULT, SERIAL_TX_RING_DEFAULT);
 	
 	// 8) MPX Modules -- *headers vary*
 	// Module specific initialization -- not all modules require this
 	klogv(COM1, "Initializing MPX modules...");
     initialize_heap(50000);
     sys_set_heap_functions(allocate_memory, free_memory);
+    timer_init();
+    klogv(COM1, intctl_init() == INTCTL_APIC
+                ? "Routing interrupts through the IO APIC, ticking from the local APIC timer..."
+                : "Routing interrupts through the 8259 PIC, ticking from the PIT...");
+
+    //The application processors are started now that the tick can time the IPIs.
+    int started_aps = smp_init();
+    char smp_msg[64] = {0};
+    sprintf("Started %d application processors, %d CPUs total...", smp_msg, 64,
+            started_aps, smp_cpu_count());
+    klogv(COM1, smp_msg);
     generate_new_pcb("comhand", 0, SYSTEM, comhand, NULL, 0, 0);
     // generate_new_pcb("p1", 7, USER, proc1);
     // generate_new_pcb("p2", 3, USER, proc2);
@@ -99,6 +131,9 @@ void kmain(void)
     // generate_new_pcb("p4", 8, USER, proc4);
     // generate_new_pcb("p4", 4, USER, proc5);
     generate_new_pcb("idle", 9, SYSTEM, sys_idle_process, NULL, 0, 0);
+    set_idle_pcb(pcb_find("idle"));
+    //The application processors get their own idle processes, and pull user processes from here on.
+    smp_start_scheduling();
 
 	// 9) YOUR command handler -- *create and #include an appropriate .h file*
 	// Pass execution to your command handler so the user can interact with the system.
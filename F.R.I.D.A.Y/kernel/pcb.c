@@ -5,6 +5,14 @@
 #include "memory.h"
 #include "mpx/pcb.h"
 #include "linked_list.h"
+#include "mpx/wait_queue.h"
+#include "mpx/ipc.h"
+#include "mpx/aio.h"
+#include "mpx/heap.h"
+#include "mpx/sys_call.h"
+#include "mpx/sched.h"
+#include "mpx/fpu.h"
+#include "mpx/smp.h"
 
 ///The PCB queue for processes.
 static linked_list *running_pcb_queue;
@@ -23,6 +31,8 @@ const char *get_class_name(enum pcb_class class)
             return "User";
         case SYSTEM:
             return "System";
+        case REALTIME:
+            return "Real-time";
         default:
             return "Unknown";
     }
@@ -84,6 +94,12 @@ void print_pcb(struct pcb *pcb_ptr)
     printf("  - Class: %s\n", get_class_name(pcb_ptr->process_class));
     printf("  - State: %s\n", get_exec_state_name(pcb_ptr->exec_state));
     printf("  - Suspended: %s\n", get_dispatch_state(pcb_ptr->dispatch_state));
+    if(pcb_ptr->process_class == REALTIME)
+    {
+        printf("  - Period: %d ticks, budget: %d ticks\n", pcb_ptr->edf.period, pcb_ptr->edf.budget);
+        printf("  - Jobs: %d, deadline misses: %d, overruns: %d\n",
+               pcb_ptr->edf.jobs, pcb_ptr->edf.misses, pcb_ptr->edf.overruns);
+    }
 }
 
 /**
@@ -108,7 +124,7 @@ int pcb_cmpr(void *ptr1, void *ptr2)
     {
         return (int) pcb_ptr1->exec_state - (int) pcb_ptr2->exec_state;
     }
-    return pcb_ptr1->priority - pcb_ptr2->priority;
+    return sched_compare(pcb_ptr1, pcb_ptr2);
 }
 
 void setup_queue()
@@ -138,6 +154,14 @@ int pcb_free(struct pcb* pcb_ptr)
     if(pcb_ptr == NULL)
         return 1;
 
+    //Nobody else can receive the messages left in its mailbox.
+    mailbox_clear(pcb_ptr);
+    mutex_release_all(pcb_ptr);
+    io_ring_release(pcb_ptr);
+    heap_disown(pcb_ptr);
+    sched_edf_release(pcb_ptr);
+    fpu_release(pcb_ptr);
+
     if(sys_free_mem((void *) pcb_ptr->name) != 0)
         return 1;
 
@@ -185,6 +209,10 @@ void pcb_insert(struct pcb* pcb_ptr)
     if(pcb_ptr == NULL)
         return;
     add_item(running_pcb_queue, pcb_ptr);
+
+    //An idle application processor can take it right away.
+    if(pcb_ptr->process_class == USER && pcb_ptr->exec_state == READY && pcb_ptr->dispatch_state == NOT_SUSPENDED)
+        smp_wake_idle();
 }
 /**
  *
@@ -209,8 +237,37 @@ struct pcb *pcb_find(const char *name)
 
         first_node = next_node(first_node);
     }
+
+    //Parked PCBs aren't in the queue.
+    for(struct pcb *parked = next_parked_pcb(NULL); parked != NULL; parked = next_parked_pcb(parked))
+    {
+        if(strcmp(parked->name, name) == 0)
+            return parked;
+    }
     return NULL;
 }
+
+struct pcb *pcb_find_any(const char *name)
+{
+    struct pcb *pcb_ptr = pcb_find(name);
+    for(int i = 0; name != NULL && pcb_ptr == NULL && i < smp_cpu_count(); ++i)
+    {
+        struct pcb *active = smp_get_cpu(i)->active;
+        if(active != NULL && strcmp(active->name, name) == 0)
+            pcb_ptr = active;
+    }
+    return pcb_ptr;
+}
+
+int pcb_running_cpu(struct pcb *pcb_ptr)
+{
+    for(int i = 0; i < smp_cpu_count(); ++i)
+    {
+        if(smp_get_cpu(i)->active == pcb_ptr)
+            return i;
+    }
+    return -1;
+}
 /**
  *
  * @param pcb_ptr
@@ -223,10 +280,88 @@ bool pcb_remove(struct pcb *pcb_ptr)
     if(pcb_ptr == NULL)
         return -1;
 
+    //Parked PCBs are only in their wait queue.
+    if(wait_queue_unpark(pcb_ptr))
+        return true;
+
     // get size of linked list
     return remove_item_ptr(running_pcb_queue, pcb_ptr) == 0 ? true : false;
 }
 
+void pcb_requeue(struct pcb *pcb_ptr)
+{
+    //A running PCB is put back in the queue by the switch away from it.
+    if(pcb_ptr->waiting_on != NULL || pcb_running_cpu(pcb_ptr) != -1)
+        return;
+
+    pcb_remove(pcb_ptr);
+    pcb_insert(pcb_ptr);
+}
+
+void pcb_resort(void)
+{
+    setup_queue();
+
+    //Insertion sort over the items, so every node stays where it is.
+    ll_node *first = get_first_node(running_pcb_queue);
+    for(ll_node *node = first != NULL ? next_node(first) : NULL; node != NULL; node = next_node(node))
+    {
+        void *item = node->_item;
+        ll_node *slot = first;
+        while(slot != node && pcb_cmpr(slot->_item, item) <= 0)
+            slot = next_node(slot);
+
+        //Shift everything from the slot up to the node along by one.
+        for(; slot != node; slot = next_node(slot))
+        {
+            void *moved = slot->_item;
+            slot->_item = item;
+            item = moved;
+        }
+        node->_item = item;
+    }
+}
+
+void pcb_for_each(void call(struct pcb *pcb_ptr))
+{
+    setup_queue();
+
+    for(int i = 0; i < smp_cpu_count(); ++i)
+    {
+        struct pcb *active = smp_get_cpu(i)->active;
+        if(active != NULL)
+            call(active);
+    }
+
+    for(ll_node *node = get_first_node(running_pcb_queue); node != NULL; node = next_node(node))
+        call((struct pcb *) get_item_node(node));
+
+    for(struct pcb *parked = next_parked_pcb(NULL); parked != NULL; parked = next_parked_pcb(parked))
+        call(parked);
+}
+
+size_t pcb_collect(struct pcb **out, size_t max)
+{
+    setup_queue();
+
+    size_t count = 0;
+    for(int i = 0; i < smp_cpu_count() && count < max; ++i)
+    {
+        struct pcb *active = smp_get_cpu(i)->active;
+        if(active != NULL)
+            out[count++] = active;
+    }
+
+    ll_node *node = get_first_node(running_pcb_queue);
+    for(; node != NULL && count < max; node = next_node(node))
+        out[count++] = (struct pcb *) get_item_node(node);
+
+    struct pcb *parked = next_parked_pcb(NULL);
+    for(; parked != NULL && count < max; parked = next_parked_pcb(parked))
+        out[count++] = parked;
+    return count;
+}
+
 ///The label for the create label.
 #define CMD_CREATE_LABEL "create"
 #define CMD_DELETE_LABEL "delete"
@@ -278,7 +413,7 @@ bool pcb_create_cmd(const char *comm)
         return true;
     }
 
-    if(pcb_find(token) != NULL)
+    if(pcb_find_any(token) != NULL)
     {
         printf("Invalid Argument! The PCB '%s' already exists!\n", token);
         return true;
@@ -369,7 +504,7 @@ bool pcb_delete_cmd(const char *comm)
     }
 
     //Find the PCB.
-    struct pcb *pcb_ptr = pcb_find(token);
+    struct pcb *pcb_ptr = pcb_find_any(token);
     if(pcb_ptr == NULL)
     {
         printf("Could not find PCB named '%s'!\n", token);
@@ -382,6 +517,14 @@ bool pcb_delete_cmd(const char *comm)
         return true;
     }
 
+    //Its stack is in use, suspending it takes it off the CPU at its next system request.
+    int cpu = pcb_running_cpu(pcb_ptr);
+    if(cpu != -1)
+    {
+        printf("PCB named '%s' is running on CPU %d, suspend it and delete it once it's stopped.\n", pcb_ptr->name, cpu);
+        return true;
+    }
+
     pcb_remove(pcb_ptr);
     pcb_free(pcb_ptr);
     printf("Removed PCB named '%s'!\n", pcb_ptr->name);
@@ -404,7 +547,7 @@ bool pcb_suspend_cmd(const char* comm)
     memcpy(comm_cpy, comm, comm_strlen + 1);
     char *name_token = strtok(comm_cpy, " ");
     name_token = strtok(NULL, " ");
-    struct pcb* pcb_ptr = pcb_find(name_token);
+    struct pcb* pcb_ptr = pcb_find_any(name_token);
     if (name_token == NULL){
         println("There was No Name Given for PCB: Enter pcb suspend name");
         return true;
@@ -420,8 +563,7 @@ bool pcb_suspend_cmd(const char* comm)
     }
     
     pcb_ptr->dispatch_state = SUSPENDED;
-    pcb_remove(pcb_ptr);
-    pcb_insert(pcb_ptr);
+    pcb_requeue(pcb_ptr);
     
     printf("The pcb named: %s was suspended\n", pcb_ptr->name);
     return true;
@@ -443,7 +585,7 @@ bool pcb_resume_cmd(const char* comm)
     char *name_value = strtok(comm_cpy, " ");
     name_value = strtok(NULL, " ");
 
-    struct pcb* pcb_ptr = pcb_find(name_value);
+    struct pcb* pcb_ptr = pcb_find_any(name_value);
     if (name_value == NULL){
         println("There was No Name Given for PCB: Enter pcb resume name");
         return true;
@@ -460,8 +602,7 @@ bool pcb_resume_cmd(const char* comm)
    
     pcb_ptr->dispatch_state = NOT_SUSPENDED;
     
-    pcb_remove(pcb_ptr);
-    pcb_insert(pcb_ptr);
+    pcb_requeue(pcb_ptr);
     printf("The pcb named: %s was resumed\n", pcb_ptr->name);
     return true;
 }
@@ -481,7 +622,7 @@ bool pcb_priority_cmd(const char* comm){
     char *parameters = strtok(comm_cpy, " ");
     parameters = strtok(NULL, " ");
 
-    struct pcb* pcb_ptr = pcb_find(parameters);
+    struct pcb* pcb_ptr = pcb_find_any(parameters);
     if (parameters == NULL){
         println("There was No Name Given for PCB: Enter pcb priority name #");
         return true;
@@ -506,8 +647,7 @@ bool pcb_priority_cmd(const char* comm){
     }
     pcb_ptr->priority = priority;
 
-    pcb_remove(pcb_ptr);
-    pcb_insert(pcb_ptr);
+    pcb_requeue(pcb_ptr);
 
     printf("The pcb named: %s was changed to priority %d\n", pcb_ptr->name, pcb_ptr->priority);
     return true;
@@ -529,7 +669,7 @@ bool pcb_show_cmd(const char* comm){
     char *name_value = strtok(comm_cpy, " ");
     name_value = strtok(NULL, " ");
 
-    struct pcb* pcb_ptr = pcb_find(name_value);
+    struct pcb* pcb_ptr = pcb_find_any(name_value);
     if (name_value == NULL){
         println("There was No Name Given for PCB: Enter pcb show name");
         return true;
@@ -608,6 +748,13 @@ bool pcb_show_blocked(const char *comm)
         first_node = next_node(first_node);
     }
 
+    //Every parked PCB is blocked.
+    for(struct pcb *parked = next_parked_pcb(NULL); parked != NULL; parked = next_parked_pcb(parked))
+    {
+        print_pcb(parked);
+        printed++;
+    }
+
     if(printed == 0)
     {
         printf("Could not find any PCBs in the blocked state\n");
@@ -640,6 +787,12 @@ bool pcb_show_all(const char *comm)
         printed++;
     }
 
+    for(struct pcb *parked = next_parked_pcb(NULL); parked != NULL; parked = next_parked_pcb(parked))
+    {
+        print_pcb(parked);
+        printed++;
+    }
+
     if(printed == 0)
     {
         println("Could not find any PCBs!");
@@ -676,8 +829,8 @@ bool generate_new_pcb(const char *name,
     if(class != USER && class != SYSTEM)
         return false;
 
-    //Can't duplicate names.
-    if(pcb_find(name) != NULL)
+    //Can't duplicate names, including those of PCBs running on another CPU.
+    if(pcb_find_any(name) != NULL)
     {
         return false;
     }
@@ -747,6 +900,20 @@ struct pcb *poll_next_pcb(void)
     return remove_item_unsafe(running_pcb_queue, 0);
 }
 
+struct pcb *poll_next_pcb_of(enum pcb_class class)
+{
+    setup_queue();
+
+    int index = 0;
+    for(ll_node *node = get_first_node(running_pcb_queue); node != NULL; node = next_node(node), ++index)
+    {
+        struct pcb *pcb_ptr = (struct pcb *) get_item_node(node);
+        if(pcb_ptr->process_class == class && pcb_ptr->exec_state == READY && pcb_ptr->dispatch_state == NOT_SUSPENDED)
+            return remove_item_unsafe(running_pcb_queue, index);
+    }
+    return NULL;
+}
+
 void exec_pcb_cmd(const char *comm)
 {
     size_t str_len = strlen(comm);
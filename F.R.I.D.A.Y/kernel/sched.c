@@ -0,0 +1,260 @@
+#include "mpx/sched.h"
+#include "mpx/timer.h"
+#include "mpx/sys_call.h"
+#include "sys_req.h"
+#include "math.h"
+
+/**
+ * @file sched.c
+ * @brief Contains the priority and multilevel feedback queue scheduling policies, and the earliest
+ * deadline first class.
+ */
+
+///The active policy.
+static enum sched_policy policy = SCHED_PRIORITY;
+///The tick of the next MLFQ reset.
+static unsigned int next_reset = MLFQ_RESET_TICKS;
+///The IO wake up latency, for each policy.
+static struct sched_latency latency[2] = {0};
+///The amount of MLFQ demotions.
+static unsigned int demotions = 0;
+///The amount of MLFQ boosts.
+static unsigned int boosts = 0;
+///The amount of MLFQ resets.
+static unsigned int resets = 0;
+///The CPU share reserved by REALTIME PCBs, in thousandths.
+static unsigned int edf_utilization = 0;
+///The deadline misses of every REALTIME PCB.
+static unsigned int edf_misses = 0;
+
+/**
+ * @brief Checks if the PCB is scheduled by the MLFQ policy, SYSTEM PCBs always keep their priority.
+ * @param pcb_ptr the PCB.
+ * @return true if its level is used.
+ */
+static bool uses_mlfq(const struct pcb *pcb_ptr)
+{
+    return policy == SCHED_MLFQ && pcb_ptr->process_class == USER;
+}
+
+/**
+ * @brief Moves the PCB to the top MLFQ level.
+ * @param pcb_ptr the PCB.
+ */
+static void reset_level(struct pcb *pcb_ptr)
+{
+    pcb_ptr->mlfq_level = 0;
+    pcb_ptr->mlfq_used = 0;
+}
+
+/**
+ * @brief Moves every PCB in the queue back into order after their priorities changed.
+ * @param reset_levels if every PCB, however many there are, should also be moved to the top level.
+ */
+static void requeue_all(bool reset_levels)
+{
+    if(reset_levels)
+        pcb_for_each(&reset_level);
+    pcb_resort();
+}
+
+enum sched_policy sched_get_policy(void)
+{
+    return policy;
+}
+
+void sched_set_policy(enum sched_policy new_policy)
+{
+    if(new_policy == policy)
+        return;
+
+    policy = new_policy;
+    next_reset = get_ticks() + MLFQ_RESET_TICKS;
+    requeue_all(true);
+}
+
+int sched_compare(const struct pcb *pcb_ptr1, const struct pcb *pcb_ptr2)
+{
+    bool realtime1 = pcb_ptr1->process_class == REALTIME;
+    bool realtime2 = pcb_ptr2->process_class == REALTIME;
+    if(realtime1 != realtime2)
+        return realtime1 ? -1 : 1;
+
+    //Compared as a difference so the tick count can wrap.
+    if(realtime1)
+        return (int) (pcb_ptr1->edf.deadline - pcb_ptr2->edf.deadline);
+
+    return sched_priority(pcb_ptr1) - sched_priority(pcb_ptr2);
+}
+
+int sched_priority(const struct pcb *pcb_ptr)
+{
+    if(!uses_mlfq(pcb_ptr))
+        return pcb_ptr->priority;
+    return MLFQ_TOP_PRIORITY + pcb_ptr->mlfq_level * 2;
+}
+
+void sched_switched_out(struct pcb *pcb_ptr, bool io_blocked)
+{
+    if(!uses_mlfq(pcb_ptr))
+        return;
+
+    //Time is charged across dispatches, so yielding just before the quantum ends doesn't help.
+    pcb_ptr->mlfq_used += get_ticks() - pcb_ptr->dispatch_tick;
+
+    if(io_blocked)
+    {
+        if(pcb_ptr->mlfq_level > 0)
+            boosts++;
+        pcb_ptr->mlfq_level = 0;
+        pcb_ptr->mlfq_used = 0;
+        return;
+    }
+
+    unsigned int quantum = MLFQ_BASE_QUANTUM << pcb_ptr->mlfq_level;
+    if(pcb_ptr->mlfq_used >= quantum && pcb_ptr->mlfq_level < MLFQ_LEVELS - 1)
+    {
+        pcb_ptr->mlfq_level++;
+        pcb_ptr->mlfq_used = 0;
+        demotions++;
+    }
+}
+
+void sched_dispatched(struct pcb *pcb_ptr, unsigned long long now)
+{
+    pcb_ptr->dispatch_tick = get_ticks();
+    if(pcb_ptr->io_completed_at == 0)
+        return;
+
+    unsigned long long waited = now - pcb_ptr->io_completed_at;
+    pcb_ptr->io_completed_at = 0;
+
+    struct sched_latency *lat = &latency[policy];
+    lat->count++;
+    lat->total_cycles += waited;
+    if(waited > lat->max_cycles)
+        lat->max_cycles = waited;
+}
+
+void sched_check(void)
+{
+    if(policy != SCHED_MLFQ || (int) (get_ticks() - next_reset) < 0)
+        return;
+
+    next_reset = get_ticks() + MLFQ_RESET_TICKS;
+    resets++;
+    requeue_all(true);
+}
+
+const struct sched_latency *sched_get_latency(enum sched_policy which)
+{
+    return &latency[which];
+}
+
+void sched_get_mlfq_stats(unsigned int *demotion_count, unsigned int *boost_count, unsigned int *reset_count)
+{
+    *demotion_count = demotions;
+    *boost_count = boosts;
+    *reset_count = resets;
+}
+
+/**
+ * @brief Gets the share of the CPU a period and budget reserve, rounded up.
+ * @param period the period.
+ * @param budget the budget.
+ * @return the share, in thousandths.
+ */
+static unsigned int edf_share(unsigned int period, unsigned int budget)
+{
+    return (budget * 1000 + period - 1) / period;
+}
+
+/**
+ * @brief Gets the cycles the PCB has run for, including its current dispatch if it's running.
+ * @param pcb_ptr the PCB.
+ * @return the cycles.
+ */
+static unsigned long long run_cycles(const struct pcb *pcb_ptr)
+{
+    if(pcb_ptr != get_active_pcb())
+        return pcb_ptr->stats.run_cycles;
+    return pcb_ptr->stats.run_cycles + rdtsc() - pcb_ptr->stats.dispatched_at;
+}
+
+int sched_edf_admit(struct pcb *caller, unsigned int period, unsigned int budget)
+{
+    if(caller == NULL || caller->process_class == SYSTEM || period == 0 || budget == 0 || budget > period)
+        return INVALID_OPERATION;
+
+    //A PCB that's already REALTIME swaps its old reservation for the new one.
+    unsigned int current = caller->process_class == REALTIME ? edf_share(caller->edf.period, caller->edf.budget) : 0;
+    unsigned int share = edf_share(period, budget);
+    if(edf_utilization - current + share > EDF_MAX_UTILIZATION)
+        return INVALID_OPERATION;
+
+    edf_utilization = edf_utilization - current + share;
+    caller->process_class = REALTIME;
+    caller->edf.period = period;
+    caller->edf.budget = budget;
+    caller->edf.release = get_ticks();
+    caller->edf.deadline = caller->edf.release + period;
+    caller->edf.job_start = run_cycles(caller);
+    return 0;
+}
+
+wait_queue_t *sched_edf_wait(struct pcb *caller)
+{
+    if(caller == NULL || caller->process_class != REALTIME)
+        return NULL;
+
+    struct pcb_edf *edf = &caller->edf;
+    unsigned int now = get_ticks();
+    unsigned long long cycles = run_cycles(caller);
+
+    //The budget can't be enforced without preemption, so running past it is only counted.
+    unsigned int used = scale_ratio(cycles - edf->job_start, get_uptime_cycles(), now);
+    if(used > edf->budget)
+        edf->overruns++;
+
+    edf->jobs++;
+    if((int) (now - edf->deadline) > 0)
+    {
+        edf->misses++;
+        edf_misses++;
+    }
+
+    //Jobs whose whole window has already passed are skipped, and missed.
+    unsigned int release = edf->deadline;
+    while((int) (now - (release + edf->period)) >= 0)
+    {
+        release += edf->period;
+        edf->misses++;
+        edf_misses++;
+    }
+
+    edf->release = release;
+    edf->deadline = release + edf->period;
+    edf->job_start = cycles;
+    if((int) (release - now) <= 0)
+        return NULL;
+    return sleep_request(release - now, caller);
+}
+
+void sched_edf_release(struct pcb *pcb_ptr)
+{
+    if(pcb_ptr->process_class != REALTIME)
+        return;
+
+    edf_utilization -= edf_share(pcb_ptr->edf.period, pcb_ptr->edf.budget);
+    pcb_ptr->process_class = USER;
+}
+
+unsigned int sched_edf_utilization(void)
+{
+    return edf_utilization;
+}
+
+unsigned int sched_edf_misses(void)
+{
+    return edf_misses;
+}
@@ -11,8 +11,34 @@
 #include "mpx/interrupts.h"
 #include "sys_req.h"
 #include "cli.h"
-#include "commands.h"
-#define RING_BUFFER_LEN 150
+#include "mpx/sys_call.h"
+#include "mpx/timer.h"
+#include "mpx/aio.h"
+#include "mpx/intctl.h"
+#include "spsc_ring.h"
+#include "mpx/smp.h"
+///The most times the serial ISR goes over every port, in case a port never stops asking.
+#define SERIAL_ISR_MAX_PASSES 16
+///The receive FIFO threshold used for typing, so every key is handled as it arrives.
+#define RX_TRIGGER_INTERACTIVE 1
+///The receive FIFO threshold used for bulk input, so a paste costs an interrupt per 14 bytes.
+#define RX_TRIGGER_BULK 14
+///The bytes drained by one interrupt that mark the input as bulk.
+#define RX_BULK_BYTES 4
+///The timeouts in a row that drain a single byte before the input is treated as typing again.
+#define RX_QUIET_TIMEOUTS 4
+///The character that tells the other side to resume sending.
+#define XON 0x11
+///The character that tells the other side to stop sending.
+#define XOFF 0x13
+///The receive ring fill, in quarters, at which the other side is told to stop.
+#define RX_HIGH_WATER_QUARTERS 3
+///The receive ring fill, in quarters, at which the other side is told to resume.
+#define RX_LOW_WATER_QUARTERS 1
+///Marks a line whose displayed text still matches the buffer.
+#define ECHO_CLEAN ((size_t) -1)
+///The longest cursor move done by re-sending the characters or backspaces instead of an escape code.
+#define ECHO_SHORT_MOVE 3
 
 #define ERROR_101 "invalid (null) event flag pointer"
 #define ERROR_102 "Invalid baud rate divisor"
@@ -125,39 +151,6 @@ static int serial_devno(device dev)
     return -1;
 }
 
-int serial_init(device dev)
-{
-    int dno = serial_devno(dev);
-    if (dno == -1)
-    {
-        return -1;
-    }
-    outb(dev + IER, 0x00);    //disable interrupts
-    outb(dev + LCR, 0x80);    //set line control register
-    outb(dev + DLL, 115200 / 9600);    //set bsd least sig bit
-    outb(dev + DLM, 0x00);    //brd most significant bit
-    outb(dev + LCR, 0x03);    //lock divisor; 8bits, no parity, one stop
-    outb(dev + FCR, 0xC7);    //enable fifo, clear, 14byte threshold
-    outb(dev + MCR, 0x0B);    //enable interrupts, rts/dsr set
-    (void) inb(dev);        //read bit to reset port
-    initialized[dno] = 1;
-    return 0;
-}
-
-int serial_out(device dev, const char *buffer, size_t len)
-{
-    int dno = serial_devno(dev);
-    if (dno == -1 || initialized[dno] == 0)
-    {
-        return -1;
-    }
-    for (size_t i = 0; i < len; i++)
-    {
-        outb(dev, buffer[i]);
-    }
-    return (int) len;
-}
-
 #define ANSI_CODE_READ_LEN 15
 #define MAX_CLI_HISTORY_LEN (5)
 
@@ -213,17 +206,22 @@ static const char *prompt = NULL;
 
 /**
  * @brief Sets the output color using serial_out instead of printf. (Avoids sys_req call)
+ * @param dev the device to set it on.
  * @param color the color to set.
+ * @return the amount of bytes written.
  */
-void internal_soc(const color_t *color)
+int internal_soc(device dev, const color_t *color)
 {
     static const char format_arr[2] = {27, '['};
     char color_arr[3] = {0};
     itoa(color->color_num, color_arr, 3);
 
-    serial_out(COM1, format_arr, 2);
-    serial_out(COM1, color_arr, strlen(color_arr));
-    serial_out(COM1, "m", 1);
+    io_segment_t sequence[3] = {
+            {format_arr, 2},
+            {color_arr, strlen(color_arr)},
+            {"m", 1},
+    };
+    return serial_outv(dev, sequence, 3);
 }
 
 void set_cli_prompt(const char *str)
@@ -259,6 +257,11 @@ void set_tab_completions(bool enabled)
     tab_completions = enabled;
 }
 
+void set_raw_input(bool raw, bool nonblocking)
+{
+    serial_set_mode(COM1, raw ? SERIAL_RAW : SERIAL_COOKED, nonblocking);
+}
+
 /**
  * @brief Moves the text cursor back the given amount of spaces.
  * @param dev the device to print to.
@@ -276,9 +279,12 @@ void move_cursor(device dev, enum direction direc, int spaces)
             '[',
             '\0'
     };
-    serial_out(dev, m_left_prefix, 2);
-    serial_out(dev, full_len_str, str_len);
-    serial_out(dev, direc == RIGHT ? "C" : "D", 1);
+    io_segment_t sequence[3] = {
+            {m_left_prefix, 2},
+            {full_len_str, str_len},
+            {direc == RIGHT ? "C" : "D", 1},
+    };
+    serial_outv(dev, sequence, 3);
 }
 
 /**
@@ -321,6 +327,9 @@ int find_next_word(enum direction direc, int cursor_index, const char *str, int
     return index;
 }
 
+///The line settings every port starts with, 8 data bits, no parity and one stop bit.
+static const struct serial_config default_config = {SERIAL_DEFAULT_BAUD, 8, 'n', 1, SERIAL_FLOW_NONE};
+
 ///An enumeration of possible DCB statuses
 typedef enum {
     IDLING,
@@ -330,17 +339,25 @@ typedef enum {
 } dcb_status_t;
 
 ///A descriptor for a device.
-typedef struct {
+typedef struct dcb {
     ///The device this control block is describing.
     device dev;
     ///Whether or not the control block is allocated.
     bool allocated;
     ///The operation this device is currently doing.
     dcb_status_t operation;
+    ///The operation that last completed.
+    dcb_status_t finished;
+    ///The time stamp the last operation completed at.
+    unsigned long long finished_at;
     ///Whether or not there is an event to be handled.
     bool event;
     ///The PCB currently using this DCB.
     struct pcb *pcb;
+    ///The ring the current operation was submitted through, or NULL.
+    struct io_ring *ring;
+    ///The user data of the current ring operation.
+    int ring_data;
     ///The amount of bytes in the IO operation.
     size_t io_bytes;
     ///The amount of bytes requested.
@@ -349,22 +366,71 @@ typedef struct {
     size_t line_pos;
     ///The active IO buffer for this DCB.
     char *io_buffer;
+    ///The segments of a vectored write left after the active one.
+    const io_segment_t *segments;
+    ///The amount of segments left after the active one.
+    size_t segments_left;
+    ///The bytes written by the finished segments of a vectored write.
+    size_t vec_done;
     ///A buffer used specifically for handling ASCII escape characters.
     char escape_buffer[6];
     ///The position in the escape buffer.
     int escape_buf_pos;
-    ///The total length of the ring buffer.
-    size_t r_buffer_len;
-    ///The current size of the ring buffer.
-    size_t r_buffer_size;
-    ///The beginning of the ring buffer.
-    char *r_buffer_start;
-    ///The read index for the ring buffer.
-    int read_index;
-    ///The write index for the ring buffer.
-    int write_index;
+    ///The receive ring, filled by the input interrupt while no read is active.
+    spsc_ring_t rx_ring;
     ///This list contains all pending operations.
     linked_list *pending_iocb;
+    ///The next DCB in the completion list.
+    struct dcb *next_completed;
+    ///Whether or not this DCB is currently in the completion list.
+    bool completion_queued;
+    ///The UART found on the device.
+    enum uart_type uart;
+    ///The bytes the UART's transmit FIFO holds.
+    size_t fifo_depth;
+    ///If the output interrupt fills the transmit FIFO instead of sending a single byte.
+    bool tx_fifo;
+    ///The transmit interrupt counters.
+    struct serial_tx_stats tx_stats;
+    ///The bytes handed to the UART since the device was set up, never reset.
+    unsigned int tx_sent;
+    ///The transmit ring the device's output is written behind into, drained by the output interrupt.
+    ///Unlike the receive ring it isn't single producer, single consumer. Writes, serial_out and the
+    ///output interrupt (refilling from the current write) produce, while the output interrupt,
+    ///tx_kick and tx_flush consume. Every one of them runs with interrupts off and the kernel lock held.
+    spsc_ring_t tx_ring;
+    ///The length of the line as it's displayed on the terminal.
+    size_t echo_len;
+    ///The cursor position on the terminal, relative to the start of the line.
+    size_t echo_pos;
+    ///The first position of the line changed since it was last echoed, or ECHO_CLEAN.
+    size_t echo_dirty;
+    ///If the displayed line is colored as an existing command.
+    bool echo_cmd_exists;
+    ///The time stamp of the input interrupt whose echo hasn't reached the UART yet, or 0.
+    unsigned long long echo_keyed_at;
+    ///The transmitted byte count at which the pending echo has reached the UART.
+    unsigned int echo_done_at;
+    ///The echo counters.
+    struct serial_echo_stats echo_stats;
+    ///The line settings of the port.
+    struct serial_config config;
+    ///The receive loss and flow control counters, with the current flow state.
+    struct serial_flow_stats flow;
+    ///The XON or XOFF to send ahead of the transmit ring, or 0.
+    char flow_char;
+    ///The traffic counters.
+    struct serial_dev_stats stats;
+    ///The time stamp the process the active operation resumes was blocked at.
+    unsigned long long blocked_at;
+    ///The line discipline reads go through.
+    enum serial_mode mode;
+    ///If raw reads complete at once when nothing is available.
+    bool nonblocking;
+    ///The receive FIFO threshold in use, in bytes.
+    int rx_trigger;
+    ///The character timeouts in a row that drained a single byte.
+    int rx_quiet;
 } dcb_t;
 
 ///A descriptor for pending IO operations.
@@ -373,12 +439,20 @@ typedef struct {
     dcb_t *device;
     ///A pointer to the process this IOCB belongs to.
     struct pcb *pcb;
+    ///The ring this IOCB was submitted through, or NULL.
+    struct io_ring *ring;
+    ///The user data of the ring operation.
+    int ring_data;
     ///The operation this IOCB is attempting.
     dcb_status_t operation;
+    ///If the buffer is an array of segments, and the length their count.
+    bool vectored;
     ///The length of the buffer.
     size_t buf_len;
     ///The buffer.
     char *buffer;
+    ///The time stamp the IOCB was queued at.
+    unsigned long long queued_at;
 } iocb_t;
 
 ///The container for all device control blocks.
@@ -389,365 +463,1469 @@ static dcb_t device_controllers[4] = {
         {.dev = COM4}
 };
 
+///The first DCB with a completed operation, in order of completion.
+static dcb_t *completed_head = NULL;
+///The last DCB with a completed operation.
+static dcb_t *completed_tail = NULL;
+
+///The names of the UART types, by type.
+static const char *uart_names[] = {"none", "8250", "16450", "16550", "16550A", "16750"};
+
 /**
- * @brief Checks if the given character is a new line character.
- *
- * @param c the character
- * @return true if the character is a new line or carriage return, false if not.
+ * @brief Finds the UART on the device by probing its FIFO and scratch registers. The FIFO is left
+ * enabled with a 14 byte receive threshold if it works, and disabled if it doesn't.
+ * Must be called with the divisor latch open, since the 16750 only takes its 64 byte FIFO bit then.
+ * @param dev the device.
+ * @return the UART type.
  */
-bool is_newline(char c)
+static enum uart_type probe_uart(device dev)
 {
-    return c == '\n' || c == '\r';
+    //Try to enable and clear the FIFO, asking for 64 bytes.
+    outb(dev + FCR, 0xE7);
+    int iir = inb(dev + IIR);
+    if((iir & 0xC0) == 0xC0)
+        return (iir & 0x20) != 0 ? UART_16750 : UART_16550A;
+
+    if((iir & 0xC0) == 0x80)
+    {
+        //The original 16550's FIFO doesn't work, so it's left off.
+        outb(dev + FCR, 0x00);
+        return UART_16550;
+    }
+
+    //No FIFO, only the 16450 has a scratch register.
+    outb(dev + SCR, 0x2A);
+    return inb(dev + SCR) == 0x2A ? UART_16450 : UART_8250;
 }
 
 /**
- * @brief Handles the new character to be inserted into the buffer.
- *        This function also handles control characters such as delete/arrow keys.
- *        Note that this will NOT handle new lines.
- *
- * @param read the character read.
- * @param buffer the buffer.
+ * @brief Gets the line control register value for the settings.
+ * @param config the settings.
+ * @return the value, or -1 if the settings are invalid.
  */
-void handle_new_char(char read, dcb_t *dcb)
+static int line_control(const struct serial_config *config)
 {
-    //Check if we're in 'escape' mode.
-    if(dcb->escape_buf_pos > 0)
-    {
-        if((size_t) dcb->escape_buf_pos + 1 >= sizeof(dcb->escape_buffer))
-        {
-            memset(dcb->escape_buffer, 0, sizeof (dcb->escape_buffer));
-            dcb->escape_buf_pos = 0;
-            return;
-        }
+    if(config->data_bits < 5 || config->data_bits > 8 || config->stop_bits < 1 || config->stop_bits > 2)
+        return -1;
 
-        //Just throw away brackets here.
-        if(read == '[')
-            return;
+    //Bits 0-1 are the data bits past 5, bit 2 two stop bits and bits 3-5 the parity.
+    int lcr = (config->data_bits - 5) | (config->stop_bits == 2 ? 0x04 : 0);
+    switch (config->parity)
+    {
+        case 'n':
+            return lcr;
+        case 'o':
+            return lcr | 0x08;
+        case 'e':
+            return lcr | 0x18;
+        case 'm':
+            return lcr | 0x28;
+        case 's':
+            return lcr | 0x38;
+        default:
+            return -1;
+    }
+}
 
-        dcb->escape_buffer[dcb->escape_buf_pos++] = read;
+/**
+ * @brief Checks if the baud rate can be divided down to from the UART's clock.
+ * @param baud the baud rate.
+ * @return true if it can.
+ */
+static bool valid_baud(int baud)
+{
+    return baud > 0 && baud <= SERIAL_MAX_BAUD && SERIAL_MAX_BAUD % baud == 0;
+}
 
-        //Try to find a match for operation.
-        if(dcb->escape_buffer[1] == 'C' || dcb->escape_buffer[1] == 'D')
-        {
-            int diff = dcb->escape_buffer[1] == 'C' ? 1 : -1;
-            if(dcb->line_pos > 0 || (diff != -1))
-            {
-                dcb->line_pos += diff;
-                dcb->line_pos = dcb->line_pos < 0 ? 0 : dcb->line_pos;
-                dcb->line_pos = (dcb->line_pos > dcb->io_bytes) ? dcb->io_bytes : dcb->line_pos;
-            }
-        }
+/**
+ * @brief Writes the settings to the UART, which have to be valid.
+ * @param dev the device.
+ * @param config the settings.
+ */
+static void apply_config(device dev, const struct serial_config *config)
+{
+    int brd = SERIAL_MAX_BAUD / config->baud;
 
-        memset(dcb->escape_buffer, 0, sizeof (dcb->escape_buffer));
-        dcb->escape_buf_pos = 0;
-        return;
-    }
+    outb(dev + LCR, 0x80);    //set line control register
+    outb(dev + DLL, brd & 0xFF);    //set bsd least sig bit
+    outb(dev + DLM, (brd >> 8) & 0xFF);    //brd most significant bit
+    outb(dev + LCR, line_control(config));    //lock divisor; data bits, parity, stop bits
+}
 
-    if (read >= SPACE && read <= TILDA)
+int serial_init(device dev)
+{
+    int dno = serial_devno(dev);
+    if (dno == -1)
     {
-        //Copy the current characters forward.
-        for (size_t i = dcb->io_bytes; i > dcb->line_pos; --i)
-        {
-            dcb->io_buffer[i] = dcb->io_buffer[i - 1];
-        }
-
-        dcb->io_buffer[dcb->line_pos++] = read;
-        dcb->io_bytes++;
+        return -1;
     }
+    dcb_t *dcb = device_controllers + dno;
+    if(dcb->config.baud == 0)
+        dcb->config = default_config;
 
-    if(read == BACKSPACE || read == DELETE)
-    {
-        if(dcb->line_pos == 0 || dcb->io_bytes == 0)
-            return;
+    outb(dev + IER, 0x00);    //disable interrupts
+    outb(dev + LCR, 0x80);    //set line control register
+    dcb->uart = probe_uart(dev);    //find the uart, enabling its fifo with a 14byte threshold
+    apply_config(dev, &dcb->config);
+    outb(dev + MCR, 0x0B);    //enable interrupts, rts/dsr set
+    (void) inb(dev);        //read bit to reset port
 
-        dcb->io_buffer[--dcb->line_pos] = '\0';
-        dcb->io_bytes--;
+    dcb->fifo_depth = dcb->uart == UART_16750 ? 64 : dcb->uart == UART_16550A ? 16 : 1;
+    dcb->tx_fifo = true;
+    dcb->rx_trigger = dcb->fifo_depth > 1 ? RX_TRIGGER_BULK : 1;
+    dcb->rx_quiet = 0;
+    initialized[dno] = 1;
+    return 0;
+}
 
-        memcpy(dcb->io_buffer + dcb->line_pos, dcb->io_buffer + dcb->line_pos + 1, dcb->io_bytes - dcb->line_pos);
-        dcb->io_buffer[dcb->io_bytes] = '\0';
-    }
+enum uart_type serial_get_uart(device dev)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || initialized[dno] == 0)
+        return UART_NONE;
+    return device_controllers[dno].uart;
+}
 
-    if(read == TAB)
-    {
-        //Find the best match.
-        const char *best = find_best_match(dcb->io_buffer);
-        if(best != NULL)
-        {
-            size_t best_len = strlen(best);
-            dcb->io_bytes = best_len;
-            dcb->line_pos = (int) dcb->io_bytes;
+const char *serial_uart_name(enum uart_type type)
+{
+    return uart_names[type];
+}
 
-            //Empty the buffer.
-            memset(dcb->io_buffer, 0, dcb->io_requested);
-            strcpy(dcb->io_buffer, best, -1);
-        }
-    }
+size_t serial_get_fifo_depth(device dev)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || device_controllers[dno].fifo_depth == 0)
+        return 1;
+    return device_controllers[dno].fifo_depth;
+}
 
-    //If we've reached an escape character, start placing things into the buffer.
-    if(read == ESCAPE)
-    {
-        dcb->escape_buf_pos = 1;
-        dcb->escape_buffer[0] = ESCAPE;
-    }
+void serial_set_tx_fifo(device dev, bool enabled)
+{
+    int dno = serial_devno(dev);
+    if(dno != -1)
+        device_controllers[dno].tx_fifo = enabled;
 }
 
-/**
- * @brief Echos the line to the output.
- * @param line the line to echo.
- * @param dcb the DCB the line belongs to.
- * @param line_pos_beginning the line position at the beginning of the read.
- */
-void echo_line(char *line, dcb_t *dcb, int line_pos_beginning)
+bool serial_get_tx_fifo(device dev)
+{
+    int dno = serial_devno(dev);
+    return dno != -1 && device_controllers[dno].tx_fifo;
+}
+
+int serial_get_rx_trigger(device dev)
 {
-    if(line_pos_beginning > 0)
-        move_cursor(dcb->dev, LEFT, line_pos_beginning);
+    int dno = serial_devno(dev);
+    if(dno == -1 || device_controllers[dno].rx_trigger == 0)
+        return 1;
+    return device_controllers[dno].rx_trigger;
+}
 
-    //Move it back one more.
-    char clear_action[5] = {
-            ESCAPE,
-            '[',
-            '0',
-            'K',
-            '\0'
-    };
+bool serial_get_tx_stats(device dev, struct serial_tx_stats *stats, bool reset)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || stats == NULL)
+        return false;
+
+    dcb_t *dcb = device_controllers + dno;
+    unsigned int flags = irq_save();
+    *stats = dcb->tx_stats;
+    if(reset)
+        memset(&dcb->tx_stats, 0, sizeof(dcb->tx_stats));
+    irq_restore(flags);
+    return true;
+}
 
-    serial_out(dcb->dev, clear_action, 4);
+int serial_set_mode(device dev, enum serial_mode mode, bool nonblocking)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1)
+        return -1;
 
-    //Get the current color.
-    const color_t *clr = get_output_color();
-    bool cmd_exists = false;
-    if(command_formatting_enabled)
-    {
-        cmd_exists = command_exists(dcb->io_buffer);
-        if(cmd_exists)
-        {
-            internal_soc(get_color("bright-green"));
-        }
-        else
-        {
-            internal_soc(get_color("red"));
-        }
-    }
+    device_controllers[dno].mode = mode;
+    device_controllers[dno].nonblocking = nonblocking;
+    return 0;
+}
 
-    serial_out(dcb->dev, line, dcb->io_bytes);
+enum serial_mode serial_get_mode(device dev)
+{
+    int dno = serial_devno(dev);
+    return dno == -1 ? SERIAL_COOKED : device_controllers[dno].mode;
+}
 
-    if(command_formatting_enabled)
-    {
-        internal_soc(clr);
-    }
+bool serial_get_echo_stats(device dev, struct serial_echo_stats *stats, bool reset)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || stats == NULL)
+        return false;
+
+    dcb_t *dcb = device_controllers + dno;
+    unsigned int flags = irq_save();
+    *stats = dcb->echo_stats;
+    if(reset)
+        memset(&dcb->echo_stats, 0, sizeof(dcb->echo_stats));
+    irq_restore(flags);
+    return true;
+}
 
-    if (dcb->io_bytes > 0)
-        move_cursor(dcb->dev, LEFT, (int) dcb->io_bytes);
+/**
+ * @brief Records the keystroke to echo latency once the pending echo has been handed to the UART.
+ * @param dcb the DCB.
+ */
+static void echo_check_sent(dcb_t *dcb)
+{
+    if(dcb->echo_keyed_at == 0 || (int) (dcb->tx_sent - dcb->echo_done_at) < 0)
+        return;
 
-    //Get the string amount to move the cursor.
-    if (dcb->line_pos > 0)
-        move_cursor(dcb->dev, RIGHT, dcb->line_pos);
+    unsigned long long latency = rdtsc() - dcb->echo_keyed_at;
+    dcb->echo_stats.latency_samples++;
+    dcb->echo_stats.latency_cycles += latency;
+    if(latency > dcb->echo_stats.max_latency_cycles)
+        dcb->echo_stats.max_latency_cycles = latency;
+    dcb->echo_keyed_at = 0;
 }
 
 /**
- * @brief The second level input handler, used for inputs.
- *
- * @param dcb the device control block in use.
- * @return 0 if the DCB should no longer be reading. Otherwise, the amount of bytes read so far.
+ * @brief Reads the line status register, counting overruns, which reading it clears.
+ * @param dcb the DCB.
+ * @return the line status.
  */
-int input_isr(dcb_t *dcb)
+static int line_status(dcb_t *dcb)
 {
-    char read = inb(dcb->dev);
-    if(dcb->operation != READING)
-    {
-        //Full? Discard the thing then.
-        if(dcb->r_buffer_len == dcb->r_buffer_size)
-            return 0;
+    int lsr = inb(dcb->dev + LSR);
+    if((lsr & 0x02) != 0)
+        dcb->flow.overruns++;
+    return lsr;
+}
 
-        dcb->r_buffer_start[dcb->write_index] = read;
-        dcb->write_index = (dcb->write_index + 1) % (int) dcb->r_buffer_len;
-        dcb->r_buffer_size++;
-        return 0;
-    }
+/**
+ * @brief Hands the UART as many bytes from the transmit ring as its FIFO holds. Only called once
+ * the transmitter is empty.
+ * @param dcb the DCB.
+ * @param forced true to send even if the other side asked this one to stop.
+ * @return the amount of bytes sent.
+ */
+static size_t fill_tx_fifo(dcb_t *dcb, bool forced)
+{
+    size_t burst = dcb->tx_fifo && dcb->fifo_depth > 1 ? dcb->fifo_depth : 1;
+    size_t sent = 0;
 
-    if(is_newline(read)) //End of line.
+    //Flow control characters go ahead of everything, even while stopped.
+    if(dcb->flow_char != 0)
     {
-        outb(dcb->dev, '\n');
-        dcb->operation = IDLING;
-        dcb->event = true;
-        return 0;
+        outb(dcb->dev + THR, dcb->flow_char);
+        dcb->flow_char = 0;
+        dcb->stats.bytes_out++;
+        sent++;
     }
 
-    size_t original = dcb->line_pos;
-    handle_new_char(read, dcb);
+    if(dcb->flow.stopped && !forced)
+        return sent;
 
-    //Echo the character.
-    echo_line(dcb->io_buffer, dcb, (int) original);
-    if(dcb->io_bytes < dcb->io_requested)
-        return 0;
+    //Only this takes bytes out of the ring, so it's at its fullest right before.
+    size_t level = spsc_count(&dcb->tx_ring);
+    if(level > dcb->stats.tx_high_water)
+        dcb->stats.tx_high_water = level;
 
-    dcb->operation = IDLING;
-    dcb->event = true;
-    return (int) dcb->io_bytes;
+    size_t from_ring = 0;
+    char out;
+    while(sent < burst && spsc_pop(&dcb->tx_ring, &out))
+    {
+        outb(dcb->dev + THR, out);
+        sent++;
+        from_ring++;
+    }
+    dcb->tx_stats.bytes += from_ring;
+    dcb->tx_sent += from_ring;
+    dcb->stats.bytes_out += from_ring;
+    echo_check_sent(dcb);
+    return sent;
 }
 
-int output_isr(dcb_t *dcb)
+/**
+ * @brief Starts draining the transmit ring, filling the FIFO now if the transmitter is empty.
+ * Otherwise the output interrupt picks the bytes up once it is.
+ * @param dcb the DCB.
+ */
+static void tx_kick(dcb_t *dcb)
 {
-    if(dcb->operation != WRITING)
-        return 0;
+    if((line_status(dcb) & 0x20) != 0)
+        fill_tx_fifo(dcb, false);
+
+    int previous = inb(dcb->dev + IER);
+    if((previous & 0x02) == 0)
+        outb(dcb->dev + IER, previous | 0x02);
+}
 
-    if(dcb->io_bytes < dcb->io_requested)
+/**
+ * @brief Empties the transmit ring by polling, for output that can't wait for the interrupt. This
+ * ignores the other side asking to stop, since it can't wait for it to resume either.
+ * @param dcb the DCB.
+ */
+static void tx_flush(dcb_t *dcb)
+{
+    while(spsc_count(&dcb->tx_ring) > 0 || dcb->flow_char != 0)
     {
-        char out = dcb->io_buffer[dcb->io_bytes++];
-        outb(dcb->dev, out);
-        return 0;
+        while((line_status(dcb) & 0x20) == 0);
+        fill_tx_fifo(dcb, true);
     }
+}
 
-    dcb->event = true;
-    dcb->operation = IDLING;
-    return (int) dcb->io_requested;
+int serial_out(device dev, const char *buffer, size_t len)
+{
+    io_segment_t segment = {buffer, len};
+    return serial_outv(dev, &segment, 1);
 }
 
-struct pcb *check_completed(void)
+int serial_outv(device dev, const io_segment_t *segments, size_t count)
 {
-    //Look for DCBs that were using this PCB.
-    for (int i = 0; i < 4; ++i)
+    int dno = serial_devno(dev);
+    if (dno == -1 || initialized[dno] == 0)
     {
-        dcb_t *dcb = device_controllers + i;
-        struct pcb *active_pcb = dcb->pcb;
-        if(!dcb->event || active_pcb == NULL) //This signifies being done, or no activity at all.
-            continue;
+        return -1;
+    }
 
-        //Check for a pending io operation.
-        if(list_size(dcb->pending_iocb) == 0)
+    int written = 0;
+    dcb_t *dcb = device_controllers + dno;
+    if(!dcb->allocated || spsc_capacity(&dcb->tx_ring) == 0)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            dcb->event = false;
-            dcb->pcb = NULL;
-            return active_pcb;
+            for (size_t j = 0; j < segments[i].length; j++)
+            {
+                outb(dev, segments[i].base[j]);
+            }
+            written += (int) segments[i].length;
         }
+        return written;
+    }
 
-        iocb_t *iocb = (iocb_t *) remove_item_unsafe(dcb->pending_iocb, 0);
-
-        int bytes_transferred = -1;
-        if(iocb->operation == READING)
-            bytes_transferred = serial_read(dcb->dev, iocb->buffer, iocb->buf_len);
-        else
-            bytes_transferred = serial_write(dcb->dev, iocb->buffer, iocb->buf_len);
-
-        dcb->pcb = iocb->pcb;
-        (void) bytes_transferred;
-        sys_free_mem(iocb);
-        return active_pcb; // This is the PCB that needs to now run as its operation was completed.
+    //Open devices go through the transmit ring, so nothing overtakes output written behind.
+    //Everything else producing into the ring runs in the kernel, this can be called outside it.
+    //Every segment goes in before the UART is kicked, once.
+    unsigned int flags = irq_save();
+    kernel_lock();
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t done = 0;
+        while(done < segments[i].length)
+        {
+            done += spsc_write(&dcb->tx_ring, segments[i].base + done, segments[i].length - done);
+            if(done < segments[i].length)
+                tx_flush(dcb);
+        }
+        written += (int) segments[i].length;
     }
-    return NULL;
+    tx_kick(dcb);
+    //With interrupts already off (a panic, or early boot) no interrupt would send the rest.
+    if((flags & 0x200) == 0)
+        tx_flush(dcb);
+    kernel_unlock();
+    irq_restore(flags);
+    return written;
 }
 
-io_req_result io_request(struct pcb *pcb, op_code operation, device dev, char *buffer, size_t length)
+size_t serial_output_pending(device dev)
 {
     int dcb_ind = serial_devno(dev);
-    if(dcb_ind == -1)
-        return INVALID_PARAMS;
+    if(dcb_ind == -1 || !device_controllers[dcb_ind].allocated)
+        return 0;
 
-    if(buffer == NULL || length <= 0)
-        return INVALID_PARAMS;
+    dcb_t *dcb = device_controllers + dcb_ind;
+    size_t pending = spsc_count(&dcb->tx_ring);
+    if(dcb->operation == WRITING)
+        return pending + dcb->io_requested - dcb->io_bytes;
+    return pending;
+}
+
+/**
+ * @brief Sets an open port up for its flow control, starting with both sides allowed to send.
+ * @param dcb the DCB.
+ */
+static void apply_flow(dcb_t *dcb)
+{
+    device dev = dcb->dev;
+    bool hardware = dcb->config.flow == SERIAL_FLOW_RTSCTS;
+
+    //Only hardware flow control needs the modem status interrupt, for CTS changes.
+    int ier = inb(dev + IER);
+    outb(dev + IER, hardware ? ier | 0x08 : ier & ~0x08);
+    outb(dev + MCR, inb(dev + MCR) | 0x02);
+    dcb->flow.throttled = false;
+    dcb->flow.stopped = hardware && (inb(dev + MSR) & 0x10) == 0;
+    tx_kick(dcb);
+}
+
+bool serial_get_flow_stats(device dev, struct serial_flow_stats *stats, bool reset)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || stats == NULL)
+        return false;
+
+    dcb_t *dcb = device_controllers + dno;
+    unsigned int flags = irq_save();
+    *stats = dcb->flow;
+    if(reset)
+    {
+        dcb->flow.dropped = dcb->flow.overruns = 0;
+        dcb->flow.throttles = dcb->flow.stops = 0;
+    }
+    irq_restore(flags);
+    return true;
+}
+
+bool serial_get_dev_stats(device dev, struct serial_dev_stats *stats, bool reset)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || stats == NULL || !device_controllers[dno].allocated)
+        return false;
+
+    dcb_t *dcb = device_controllers + dno;
+    unsigned int flags = irq_save();
+    *stats = dcb->stats;
+    stats->rx_capacity = spsc_capacity(&dcb->rx_ring);
+    stats->tx_capacity = spsc_capacity(&dcb->tx_ring);
+    stats->queue_depth = list_size(dcb->pending_iocb);
+    if(reset)
+    {
+        memset(&dcb->stats, 0, sizeof(dcb->stats));
+        dcb->stats.rx_high_water = spsc_count(&dcb->rx_ring);
+        dcb->stats.tx_high_water = spsc_count(&dcb->tx_ring);
+        dcb->stats.max_queue_depth = stats->queue_depth;
+    }
+    irq_restore(flags);
+    return true;
+}
+
+int serial_configure(device dev, const struct serial_config *config)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || config == NULL || line_control(config) == -1 || config->flow > SERIAL_FLOW_XONXOFF)
+        return -1;
+
+    if(!valid_baud(config->baud))
+        return -102;
+
+    dcb_t *dcb = device_controllers + dno;
+
+    //Let what was written go out at the old settings, including the rest of a write in progress.
+    //It drains with interrupts on, they're only turned off for the last few bytes.
+    unsigned int flags;
+    for(;;)
+    {
+        while(dcb->allocated && serial_output_pending(dev) > 0 && !dcb->flow.stopped)
+            sys_req(IDLE);
+
+        //Another write may have started in the meantime, and has to go out first as well.
+        flags = irq_save();
+        if(dcb->operation != WRITING || dcb->flow.stopped)
+            break;
+        irq_restore(flags);
+    }
+
+    if(dcb->allocated)
+    {
+        //Anything written behind since, then the bits still in the FIFO and shift register.
+        tx_flush(dcb);
+        while((line_status(dcb) & 0x40) == 0);
+    }
+
+    dcb->config = *config;
+    apply_config(dev, config);
+    if(dcb->allocated)
+        apply_flow(dcb);
+    irq_restore(flags);
+    return 0;
+}
+
+bool serial_get_config(device dev, struct serial_config *config)
+{
+    int dno = serial_devno(dev);
+    if(dno == -1 || config == NULL)
+        return false;
+
+    *config = device_controllers[dno].config.baud != 0 ? device_controllers[dno].config : default_config;
+    return true;
+}
+
+/**
+ * @brief Marks the DCB's current operation as finished and adds the DCB to the completion list.
+ *        Nothing is allocated here, so this is safe to call from the interrupt handlers.
+ *
+ * @param dcb the DCB that finished its operation.
+ */
+static void complete_operation(dcb_t *dcb)
+{
+    dcb->finished = dcb->operation;
+    dcb->finished_at = rdtsc();
+    dcb->operation = IDLING;
+    dcb->event = true;
+
+    if(dcb->completion_queued)
+        return;
+
+    dcb->completion_queued = true;
+    dcb->next_completed = NULL;
+    if(completed_tail != NULL)
+        completed_tail->next_completed = dcb;
+    else
+        completed_head = dcb;
+    completed_tail = dcb;
+}
+
+/**
+ * @brief Removes the oldest DCB from the completion list.
+ * @return the DCB, or NULL if no operations have completed.
+ */
+static dcb_t *poll_completed(void)
+{
+    dcb_t *dcb = completed_head;
+    if(dcb == NULL)
+        return NULL;
+
+    completed_head = dcb->next_completed;
+    if(completed_head == NULL)
+        completed_tail = NULL;
+
+    dcb->next_completed = NULL;
+    dcb->completion_queued = false;
+    return dcb;
+}
+
+/**
+ * @brief Takes the DCB off the completion list, for a completion that was already handled.
+ * @param dcb the DCB.
+ */
+static void unqueue_completed(dcb_t *dcb)
+{
+    if(!dcb->completion_queued)
+        return;
+
+    dcb_t *prev = NULL;
+    for(dcb_t *walk = completed_head; walk != NULL; prev = walk, walk = walk->next_completed)
+    {
+        if(walk != dcb)
+            continue;
+
+        if(prev != NULL)
+            prev->next_completed = dcb->next_completed;
+        else
+            completed_head = dcb->next_completed;
+        if(completed_tail == dcb)
+            completed_tail = prev;
+        break;
+    }
+    dcb->next_completed = NULL;
+    dcb->completion_queued = false;
+}
+
+bool io_completion_pending(void)
+{
+    return completed_head != NULL;
+}
+
+size_t serial_input_available(device dev)
+{
+    int dcb_ind = serial_devno(dev);
+    if(dcb_ind == -1 || !device_controllers[dcb_ind].allocated)
+        return 0;
+
+    return spsc_count(&device_controllers[dcb_ind].rx_ring);
+}
+
+/**
+ * @brief Checks if the given character is a new line character.
+ *
+ * @param c the character
+ * @return true if the character is a new line or carriage return, false if not.
+ */
+bool is_newline(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+/**
+ * @brief Marks the line as changed from the given position on, so the next echo redraws it.
+ * @param dcb the DCB.
+ * @param pos the first changed position.
+ */
+static void mark_dirty(dcb_t *dcb, size_t pos)
+{
+    if(pos < dcb->echo_dirty)
+        dcb->echo_dirty = pos;
+}
+
+/**
+ * @brief Handles the new character to be inserted into the buffer.
+ *        This function also handles control characters such as delete/arrow keys.
+ *        Note that this will NOT handle new lines.
+ *
+ * @param read the character read.
+ * @param buffer the buffer.
+ */
+void handle_new_char(char read, dcb_t *dcb)
+{
+    //Check if we're in 'escape' mode.
+    if(dcb->escape_buf_pos > 0)
+    {
+        if((size_t) dcb->escape_buf_pos + 1 >= sizeof(dcb->escape_buffer))
+        {
+            memset(dcb->escape_buffer, 0, sizeof (dcb->escape_buffer));
+            dcb->escape_buf_pos = 0;
+            return;
+        }
+
+        //Just throw away brackets here.
+        if(read == '[')
+            return;
+
+        dcb->escape_buffer[dcb->escape_buf_pos++] = read;
+
+        //Try to find a match for operation.
+        if(dcb->escape_buffer[1] == 'C' || dcb->escape_buffer[1] == 'D')
+        {
+            int diff = dcb->escape_buffer[1] == 'C' ? 1 : -1;
+            if(dcb->line_pos > 0 || (diff != -1))
+            {
+                dcb->line_pos += diff;
+                dcb->line_pos = dcb->line_pos < 0 ? 0 : dcb->line_pos;
+                dcb->line_pos = (dcb->line_pos > dcb->io_bytes) ? dcb->io_bytes : dcb->line_pos;
+            }
+        }
+
+        memset(dcb->escape_buffer, 0, sizeof (dcb->escape_buffer));
+        dcb->escape_buf_pos = 0;
+        return;
+    }
+
+    if (read >= SPACE && read <= TILDA)
+    {
+        mark_dirty(dcb, dcb->line_pos);
+
+        //Copy the current characters forward.
+        for (size_t i = dcb->io_bytes; i > dcb->line_pos; --i)
+        {
+            dcb->io_buffer[i] = dcb->io_buffer[i - 1];
+        }
+
+        dcb->io_buffer[dcb->line_pos++] = read;
+        dcb->io_bytes++;
+    }
+
+    if(read == BACKSPACE || read == DELETE)
+    {
+        if(dcb->line_pos == 0 || dcb->io_bytes == 0)
+            return;
+
+        dcb->io_buffer[--dcb->line_pos] = '\0';
+        dcb->io_bytes--;
+        mark_dirty(dcb, dcb->line_pos);
+
+        memcpy(dcb->io_buffer + dcb->line_pos, dcb->io_buffer + dcb->line_pos + 1, dcb->io_bytes - dcb->line_pos);
+        dcb->io_buffer[dcb->io_bytes] = '\0';
+    }
+
+    if(read == TAB)
+    {
+        //Find the best match.
+        const char *best = find_best_match(dcb->io_buffer);
+        if(best != NULL)
+        {
+            size_t best_len = strlen(best);
+            mark_dirty(dcb, 0);
+            dcb->io_bytes = best_len;
+            dcb->line_pos = (int) dcb->io_bytes;
+
+            //Empty the buffer.
+            memset(dcb->io_buffer, 0, dcb->io_requested);
+            strcpy(dcb->io_buffer, best, -1);
+        }
+    }
+
+    //If we've reached an escape character, start placing things into the buffer.
+    if(read == ESCAPE)
+    {
+        dcb->escape_buf_pos = 1;
+        dcb->escape_buffer[0] = ESCAPE;
+    }
+}
+
+/**
+ * @brief Moves the terminal cursor along the line. Short moves re-send the characters already on
+ * screen or backspaces, which is cheaper than an escape code.
+ * @param dcb the DCB.
+ * @param to the position to move to, the part of the line up to it has to be displayed as is.
+ * @return the amount of bytes written.
+ */
+static size_t echo_move(dcb_t *dcb, size_t to)
+{
+    size_t from = dcb->echo_pos;
+    dcb->echo_pos = to;
+    if(to == from)
+        return 0;
+
+    size_t spaces = to > from ? to - from : from - to;
+    if(spaces <= ECHO_SHORT_MOVE)
+    {
+        //Re-sent characters would lose their command color, so only plain lines take the shortcut.
+        if(to < from)
+            return serial_out(dcb->dev, "\b\b\b", spaces);
+        if(!command_formatting_enabled)
+            return serial_out(dcb->dev, dcb->io_buffer + from, spaces);
+    }
+
+    char sequence[16] = {ESCAPE, '['};
+    itoa((int) spaces, sequence + 2, 12);
+    size_t len = strlen(sequence);
+    sequence[len++] = to > from ? 'C' : 'D';
+    return serial_out(dcb->dev, sequence, len);
+}
+
+/**
+ * @brief Brings the displayed line up to date with the DCB's buffer. Only the part after the
+ * first change is written, so typing at the end of a line echoes just the new character.
+ * @param dcb the DCB.
+ * @return the amount of bytes written.
+ */
+static size_t echo_update(dcb_t *dcb)
+{
+    size_t from = dcb->echo_dirty < dcb->echo_len ? dcb->echo_dirty : dcb->echo_len;
+    dcb->echo_dirty = ECHO_CLEAN;
+
+    //The whole line changes color when it starts or stops naming a command.
+    bool cmd_exists = false;
+    if(command_formatting_enabled)
+    {
+        cmd_exists = command_exists(dcb->io_buffer);
+        if(cmd_exists != dcb->echo_cmd_exists)
+            from = 0;
+        dcb->echo_cmd_exists = cmd_exists;
+    }
+
+    size_t written = 0;
+    if(from < dcb->io_bytes || dcb->io_bytes < dcb->echo_len)
+    {
+        written += echo_move(dcb, from);
+
+        const color_t *clr = get_output_color();
+        if(command_formatting_enabled)
+            written += internal_soc(dcb->dev, get_color(cmd_exists ? "bright-green" : "red"));
+
+        written += serial_out(dcb->dev, dcb->io_buffer + from, dcb->io_bytes - from);
+
+        if(command_formatting_enabled)
+            written += internal_soc(dcb->dev, clr);
+
+        //Clear whatever is left of a longer line.
+        if(dcb->io_bytes < dcb->echo_len)
+        {
+            static const char clear_action[3] = {ESCAPE, '[', 'K'};
+            written += serial_out(dcb->dev, clear_action, sizeof(clear_action));
+        }
+
+        dcb->echo_pos = dcb->echo_len = dcb->io_bytes;
+    }
+
+    written += echo_move(dcb, dcb->line_pos);
+    return written;
+}
+
+/**
+ * @brief Echos the keystrokes of an input interrupt, counting the bytes it took and waiting for
+ * them to reach the UART to time the echo.
+ * @param dcb the DCB.
+ * @param keystrokes the keystrokes being echoed.
+ * @param keyed_at the time stamp the interrupt started at.
+ */
+static void echo_keystrokes(dcb_t *dcb, size_t keystrokes, unsigned long long keyed_at)
+{
+    size_t written = echo_update(dcb);
+    dcb->echo_stats.keystrokes += keystrokes;
+    dcb->echo_stats.bytes += written;
+    if(written == 0 || dcb->echo_keyed_at != 0)
+        return;
+
+    //The echo is on the wire once everything queued ahead of it and itself has been sent.
+    dcb->echo_keyed_at = keyed_at;
+    dcb->echo_done_at = dcb->tx_sent + spsc_count(&dcb->tx_ring);
+    echo_check_sent(dcb);
+}
+
+/**
+ * @brief Sets the receive FIFO threshold of the DCB's UART, without clearing the FIFO.
+ * @param dcb the DCB.
+ * @param trigger RX_TRIGGER_INTERACTIVE or RX_TRIGGER_BULK.
+ */
+static void set_rx_trigger(dcb_t *dcb, int trigger)
+{
+    if(dcb->fifo_depth <= 1 || dcb->rx_trigger == trigger)
+        return;
+
+    //Bits 6-7 select the threshold, 00 for 1 byte and 11 for 14.
+    outb(dcb->dev + FCR, trigger == RX_TRIGGER_BULK ? 0xC1 : 0x01);
+    dcb->rx_trigger = trigger;
+    dcb->rx_quiet = 0;
+}
+
+/**
+ * @brief Picks the receive threshold from what one interrupt drained. Several bytes at once
+ * means input is arriving faster than it's typed, so the FIFO is left to fill. Timeouts
+ * holding a single byte mean someone is typing, so every byte interrupts right away.
+ * @param dcb the DCB.
+ * @param drained the bytes the interrupt drained.
+ * @param timeout if the interrupt was a character timeout.
+ */
+static void adapt_rx_trigger(dcb_t *dcb, size_t drained, bool timeout)
+{
+    if(drained >= RX_BULK_BYTES)
+    {
+        set_rx_trigger(dcb, RX_TRIGGER_BULK);
+        return;
+    }
+
+    if(!timeout || dcb->rx_trigger != RX_TRIGGER_BULK)
+        return;
+
+    if(drained > 1)
+        dcb->rx_quiet = 0;
+    else if(++dcb->rx_quiet >= RX_QUIET_TIMEOUTS)
+        set_rx_trigger(dcb, RX_TRIGGER_INTERACTIVE);
+}
+
+/**
+ * @brief Stops or resumes sending, as the other side asked.
+ * @param dcb the DCB.
+ * @param stopped true if it asked to stop.
+ */
+static void set_stopped(dcb_t *dcb, bool stopped)
+{
+    if(dcb->flow.stopped == stopped)
+        return;
+
+    dcb->flow.stopped = stopped;
+    if(stopped)
+        dcb->flow.stops++;
+    else
+        tx_kick(dcb);
+}
+
+/**
+ * @brief Tells the other side to stop or resume sending, by RTS or XOFF and XON.
+ * @param dcb the DCB.
+ * @param throttle true to stop it, false to let it resume.
+ */
+static void set_throttle(dcb_t *dcb, bool throttle)
+{
+    if(dcb->config.flow == SERIAL_FLOW_NONE || dcb->flow.throttled == throttle)
+        return;
+
+    dcb->flow.throttled = throttle;
+    if(throttle)
+        dcb->flow.throttles++;
+
+    if(dcb->config.flow == SERIAL_FLOW_RTSCTS)
+    {
+        int mcr = inb(dcb->dev + MCR);
+        outb(dcb->dev + MCR, throttle ? mcr & ~0x02 : mcr | 0x02);
+        return;
+    }
+
+    dcb->flow_char = throttle ? XOFF : XON;
+    tx_kick(dcb);
+}
+
+/**
+ * @brief Lets the other side resume sending once reads have emptied the receive ring enough.
+ * @param dcb the DCB.
+ */
+static void check_unthrottle(dcb_t *dcb)
+{
+    if(dcb->flow.throttled && spsc_count(&dcb->rx_ring) * 4 <= spsc_capacity(&dcb->rx_ring) * RX_LOW_WATER_QUARTERS)
+        set_throttle(dcb, false);
+}
+
+/**
+ * @brief Handles a received XON or XOFF when software flow control is on.
+ * @param dcb the DCB.
+ * @param read the received byte.
+ * @return true if it was a flow control character, which isn't passed on.
+ */
+static bool handle_flow_char(dcb_t *dcb, char read)
+{
+    if(dcb->config.flow != SERIAL_FLOW_XONXOFF || (read != XON && read != XOFF))
+        return false;
+
+    set_stopped(dcb, read == XOFF);
+    return true;
+}
+
+/**
+ * @brief Stores a byte that arrived while no read was active in the DCB's ring buffer.
+ * @param dcb the DCB.
+ * @param read the byte.
+ */
+static void buffer_input(dcb_t *dcb, char read)
+{
+    //Full? Discard the thing then.
+    if(!spsc_push(&dcb->rx_ring, read))
+        dcb->flow.dropped++;
+
+    size_t level = spsc_count(&dcb->rx_ring);
+    if(level > dcb->stats.rx_high_water)
+        dcb->stats.rx_high_water = level;
+
+    if(!dcb->flow.throttled && spsc_count(&dcb->rx_ring) * 4 >= spsc_capacity(&dcb->rx_ring) * RX_HIGH_WATER_QUARTERS)
+        set_throttle(dcb, true);
+}
+
+/**
+ * @brief The second level input handler, used for inputs. Drains every byte in the receive FIFO,
+ * and echoes them together once they've all been handled.
+ *
+ * @param dcb the device control block in use.
+ * @param timeout if the interrupt was a character timeout, rather than the FIFO threshold.
+ * @return 0 if the DCB should no longer be reading. Otherwise, the amount of bytes read so far.
+ */
+int input_isr(dcb_t *dcb, bool timeout)
+{
+    unsigned long long keyed_at = rdtsc();
+    size_t edited = 0;
+    size_t drained = 0;
+    int result = 0;
+    do
+    {
+        char read = inb(dcb->dev + RBR);
+        drained++;
+        if(handle_flow_char(dcb, read))
+            continue;
+
+        if(dcb->operation != READING)
+        {
+            buffer_input(dcb, read);
+            continue;
+        }
+
+        //Raw reads take the bytes as they are, and finish with whatever this interrupt drained.
+        if(dcb->mode == SERIAL_RAW)
+        {
+            dcb->io_buffer[dcb->io_bytes++] = read;
+            if(dcb->io_bytes >= dcb->io_requested)
+            {
+                complete_operation(dcb);
+                result = (int) dcb->io_bytes;
+            }
+            continue;
+        }
+
+        bool finished = is_newline(read);
+        if(!finished)
+        {
+            handle_new_char(read, dcb);
+            edited++;
+            finished = dcb->io_bytes >= dcb->io_requested;
+            result = finished ? (int) dcb->io_bytes : 0;
+        }
+
+        if(!finished)
+            continue;
+
+        //Echo everything the line got before it completes.
+        if(edited > 0)
+            echo_keystrokes(dcb, edited, keyed_at);
+        if(is_newline(read))
+            serial_out(dcb->dev, "\n", 1);
+        edited = 0;
+        complete_operation(dcb);
+    } while ((line_status(dcb) & 0x01) != 0);
+
+    if(edited > 0)
+        echo_keystrokes(dcb, edited, keyed_at);
+
+    if(dcb->operation == READING && dcb->mode == SERIAL_RAW && dcb->io_bytes > 0)
+    {
+        complete_operation(dcb);
+        result = (int) dcb->io_bytes;
+    }
+
+    dcb->stats.bytes_in += drained;
+    adapt_rx_trigger(dcb, drained, timeout);
+    return result;
+}
+
+/**
+ * @brief Takes the next byte of the DCB's write, moving on to the next segment of a vectored write.
+ * @param dcb the writing DCB.
+ * @param out where to put the byte.
+ * @return true if there was a byte, false if the write has nothing left.
+ */
+static bool next_output_byte(dcb_t *dcb, char *out)
+{
+    //Move on to the next segment of a vectored write.
+    while(dcb->io_bytes >= dcb->io_requested)
+    {
+        if(dcb->segments_left == 0)
+            return false;
+
+        const io_segment_t *segment = dcb->segments++;
+        dcb->segments_left--;
+        dcb->vec_done += dcb->io_requested;
+        dcb->io_buffer = (char *) segment->base;
+        dcb->io_requested = segment->length;
+        dcb->io_bytes = 0;
+    }
+
+    *out = dcb->io_buffer[dcb->io_bytes++];
+    return true;
+}
+
+/**
+ * @brief Moves as much of the DCB's write as fits into its transmit ring. The write completes
+ * once all of it is in the ring, rather than once it's been transmitted.
+ * @param dcb the DCB.
+ */
+static void refill_tx_ring(dcb_t *dcb)
+{
+    if(dcb->operation != WRITING)
+        return;
+
+    char out;
+    while(spsc_space(&dcb->tx_ring) > 0)
+    {
+        if(!next_output_byte(dcb, &out))
+        {
+            complete_operation(dcb);
+            return;
+        }
+        spsc_push(&dcb->tx_ring, out);
+    }
+
+    //Finish as soon as the last byte is in, rather than on the next interrupt.
+    if(dcb->io_bytes >= dcb->io_requested && dcb->segments_left == 0)
+        complete_operation(dcb);
+}
+
+/**
+ * @brief The second level output handler. Refills the transmit ring from the current write, and
+ * the UART's FIFO from the ring.
+ *
+ * @param dcb the device control block in use.
+ * @return the amount of bytes sent to the UART.
+ */
+int output_isr(dcb_t *dcb)
+{
+    unsigned long long start = rdtsc();
+    dcb->tx_stats.thre_interrupts++;
+    refill_tx_ring(dcb);
+    size_t sent = fill_tx_fifo(dcb, false);
+    refill_tx_ring(dcb);
+    dcb->tx_stats.isr_cycles += rdtsc() - start;
+    return (int) sent;
+}
+
+/**
+ * @brief Starts the oldest pending operation on the DCB, if there is one.
+ * @param dcb the idle DCB.
+ */
+static void start_next_iocb(dcb_t *dcb)
+{
+    if(list_size(dcb->pending_iocb) == 0)
+        return;
+
+    iocb_t *iocb = (iocb_t *) remove_item_unsafe(dcb->pending_iocb, 0);
+    dcb->pcb = iocb->pcb;
+    dcb->blocked_at = iocb->queued_at;
+    dcb->ring = iocb->ring;
+    dcb->ring_data = iocb->ring_data;
+    if(iocb->operation == READING)
+        serial_read(dcb->dev, iocb->buffer, iocb->buf_len);
+    else if(iocb->vectored)
+        serial_writev(dcb->dev, (const io_segment_t *) iocb->buffer, iocb->buf_len);
+    else
+        serial_write(dcb->dev, iocb->buffer, iocb->buf_len);
+    sys_free_mem(iocb);
+}
+
+struct pcb *check_completed(void)
+{
+    //Only DCBs that signalled a completion need to be looked at.
+    dcb_t *dcb;
+    while ((dcb = poll_completed()) != NULL)
+    {
+        if(!dcb->event) //No activity at all.
+            continue;
+
+        struct pcb *active_pcb = dcb->pcb;
+        dcb->event = false;
+        dcb->pcb = NULL;
+
+        //The process has waited from its request until now, when it's made ready again.
+        if(active_pcb != NULL)
+        {
+            unsigned long long blocked = rdtsc() - dcb->blocked_at;
+            dcb->stats.blocked_waits++;
+            dcb->stats.blocked_cycles += blocked;
+            if(blocked > dcb->stats.max_blocked_cycles)
+                dcb->stats.max_blocked_cycles = blocked;
+        }
+
+        //Charge the transfer to whoever asked for it.
+        struct pcb *owner = active_pcb != NULL ? active_pcb : dcb->ring != NULL ? dcb->ring->owner : NULL;
+        if(owner != NULL)
+        {
+            size_t transferred = dcb->vec_done + dcb->io_bytes;
+            if(dcb->finished == READING)
+                owner->stats.bytes_read += transferred;
+            else
+                owner->stats.bytes_written += transferred;
+        }
+
+        //Ring operations post a completion instead of resuming a process.
+        if(dcb->ring != NULL)
+        {
+            io_ring_post(dcb->ring, dcb->ring_data, (int) (dcb->vec_done + dcb->io_bytes));
+            dcb->ring = NULL;
+        }
+
+        start_next_iocb(dcb);
+
+        if(active_pcb != NULL)
+        {
+            //The request returns the amount of bytes transferred, the running PCB's context isn't saved yet.
+            if(active_pcb != get_active_pcb())
+                ((struct context *) active_pcb->stack_ptr)->eax = (int) (dcb->vec_done + dcb->io_bytes);
+            active_pcb->io_completed_at = dcb->finished_at;
+            return active_pcb; // This is the PCB that needs to now run as its operation was completed.
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Queues an operation until the DCB is idle.
+ * @param dcb the busy DCB.
+ * @param pcb the PCB to resume once the operation completes, or NULL.
+ * @param ring the ring to post the completion to, or NULL.
+ * @param ring_data the user data of the ring operation.
+ * @param operation the operation.
+ * @param buffer the buffer.
+ * @param length the amount of characters to transfer.
+ * @return true if it was queued, false if it couldn't be allocated.
+ */
+static bool queue_iocb(dcb_t *dcb, struct pcb *pcb, struct io_ring *ring, int ring_data,
+                       op_code operation, char *buffer, size_t length)
+{
+    iocb_t *iocb = sys_alloc_mem(sizeof (iocb_t));
+    if(iocb == NULL)
+        return false;
+
+    memset(iocb, 0, sizeof (iocb_t));
+    iocb->buf_len = length;
+    iocb->buffer = buffer;
+    iocb->device = dcb;
+    iocb->operation = operation == READ ? READING : WRITING;
+    iocb->vectored = operation == WRITEV;
+    iocb->pcb = pcb;
+    iocb->ring = ring;
+    iocb->ring_data = ring_data;
+    iocb->queued_at = rdtsc();
+
+    add_item(dcb->pending_iocb, iocb);
+    size_t depth = list_size(dcb->pending_iocb);
+    if(depth > dcb->stats.max_queue_depth)
+        dcb->stats.max_queue_depth = depth;
+    return true;
+}
+
+/**
+ * @brief Checks if the DCB can't start a new operation, either because it's still running one
+ *        or because its last completion hasn't been handled yet.
+ * @param dcb the DCB.
+ * @return true if new operations have to be queued.
+ */
+static bool dcb_busy(dcb_t *dcb)
+{
+    return dcb->operation != IDLING || dcb->completion_queued;
+}
+
+/**
+ * @brief Copies a write straight into the transmit ring if all of it fits there and no other
+ * write is ahead of it, so the writer doesn't wait for the UART.
+ * @param dcb the DCB.
+ * @param operation WRITE or WRITEV.
+ * @param buffer the buffer, or the segments for WRITEV.
+ * @param length the length of the buffer, or the amount of segments.
+ * @return the bytes written behind, 0 if it has to be started as an operation.
+ */
+static size_t write_behind(dcb_t *dcb, op_code operation, char *buffer, size_t length)
+{
+    if(dcb->operation == WRITING || list_size(dcb->pending_iocb) > 0)
+        return 0;
+
+    if(operation == WRITE)
+    {
+        if(length > spsc_space(&dcb->tx_ring))
+            return 0;
+        spsc_write(&dcb->tx_ring, buffer, length);
+        tx_kick(dcb);
+        return length;
+    }
+
+    const io_segment_t *segments = (const io_segment_t *) buffer;
+    size_t total = 0;
+    for (size_t i = 0; i < length; ++i)
+        total += segments[i].length;
+    if(total == 0 || total > spsc_space(&dcb->tx_ring))
+        return 0;
+
+    for (size_t i = 0; i < length; ++i)
+        spsc_write(&dcb->tx_ring, segments[i].base, segments[i].length);
+    tx_kick(dcb);
+    return total;
+}
 
-    if(operation != WRITE && operation != READ)
+io_req_result io_request(struct pcb *pcb, op_code operation, device dev, char *buffer, size_t length,
+                         size_t *transferred)
+{
+    int dcb_ind = serial_devno(dev);
+    if(dcb_ind == -1)
+        return INVALID_PARAMS;
+
+    if(buffer == NULL || length <= 0)
+        return INVALID_PARAMS;
+
+    if(operation != WRITE && operation != WRITEV && operation != READ)
         return INVALID_PARAMS;
 
     dcb_t *dcb = device_controllers + dcb_ind;
     if(!dcb->allocated)
         return DEVICE_CLOSED;
 
-    if(dcb->operation != IDLING)
+    //The caller only waits for a write that doesn't fit in the transmit ring.
+    size_t behind = operation != READ ? write_behind(dcb, operation, buffer, length) : 0;
+    if(behind > 0)
+    {
+        if(pcb != NULL)
+            pcb->stats.bytes_written += behind;
+        *transferred = behind;
+        return SERVICED;
+    }
+
+    if(dcb_busy(dcb))
     {
         //Create an IOCB and add it to the pending list.
-        iocb_t *iocb = sys_alloc_mem(sizeof (iocb_t));
-        memset(iocb, 0, sizeof (iocb_t));
-        iocb->buf_len = length;
-        iocb->buffer = buffer;
-        iocb->device = dcb;
-        iocb->operation = operation == WRITE ? WRITING : READING;
-        iocb->pcb = pcb;
-
-        add_item(dcb->pending_iocb, iocb);
+        if(!queue_iocb(dcb, pcb, NULL, 0, operation, buffer, length))
+            return INVALID_PARAMS;
         return DEVICE_BUSY;
     }
 
     dcb->pcb = pcb;
+    dcb->ring = NULL;
+    dcb->blocked_at = rdtsc();
+    int started;
     if(operation == READ)
+        started = serial_read(dev, buffer, length);
+    else if(operation == WRITE)
+        started = serial_write(dev, buffer, length);
+    else
+        started = serial_writev(dev, (const io_segment_t *) buffer, length);
+
+    if(started < 0)
     {
-        int read = serial_read(dev, buffer, length);
-        return read < (int) length ? PARTIALLY_SERVICED : SERVICED;
+        dcb->pcb = NULL;
+        return INVALID_PARAMS;
     }
-    else if(operation == WRITE)
+
+    //Still running, so the caller waits for check_completed.
+    if(dcb->operation != IDLING)
+        return PARTIALLY_SERVICED;
+
+    //The caller keeps running, so there's nobody to resume when the completion is handled. The
+    //DCB is taken off the completion list too, otherwise it stays busy until check_completed runs
+    //and the caller's next request (a poll, or a buffered read) would block.
+    dcb->pcb = NULL;
+    dcb->event = false;
+    unqueue_completed(dcb);
+    *transferred = dcb->vec_done + dcb->io_bytes;
+    if(pcb != NULL && operation == READ)
+        pcb->stats.bytes_read += *transferred;
+    else if(pcb != NULL)
+        pcb->stats.bytes_written += *transferred;
+    start_next_iocb(dcb);
+    return SERVICED;
+}
+
+io_req_result io_submit(struct io_ring *ring, int user_data, op_code operation, device dev, char *buffer, size_t length)
+{
+    int dcb_ind = serial_devno(dev);
+    if(dcb_ind == -1 || ring == NULL)
+        return INVALID_PARAMS;
+
+    if(buffer == NULL || length <= 0)
+        return INVALID_PARAMS;
+
+    if(operation != WRITE && operation != WRITEV && operation != READ)
+        return INVALID_PARAMS;
+
+    dcb_t *dcb = device_controllers + dcb_ind;
+    if(!dcb->allocated)
+        return DEVICE_CLOSED;
+
+    if(dcb_busy(dcb))
+        return queue_iocb(dcb, NULL, ring, user_data, operation, buffer, length) ? DEVICE_BUSY : INVALID_PARAMS;
+
+    //Even if it finishes right away, the completion is posted by check_completed.
+    dcb->pcb = NULL;
+    dcb->ring = ring;
+    dcb->ring_data = user_data;
+    if(operation == READ)
+        serial_read(dev, buffer, length);
+    else if(operation == WRITEV)
+        serial_writev(dev, (const io_segment_t *) buffer, length);
+    else
+        serial_write(dev, buffer, length);
+    return PARTIALLY_SERVICED;
+}
+
+void io_cancel_ring(struct io_ring *ring)
+{
+    unsigned int flags = irq_save();
+    for (size_t i = 0; i < sizeof(device_controllers) / sizeof(device_controllers[0]); ++i)
     {
-        int written = serial_write(dev, buffer, length);
-        return written < (int) length ? PARTIALLY_SERVICED : SERVICED;
+        dcb_t *dcb = device_controllers + i;
+        if(!dcb->allocated)
+            continue;
+
+        //Drop the ring's queued operations, their buffers belong to a process that's going away.
+        for (int j = list_size(dcb->pending_iocb) - 1; j >= 0; --j)
+        {
+            iocb_t *iocb = get_item(dcb->pending_iocb, j);
+            if(iocb->ring != ring)
+                continue;
+            remove_item_unsafe(dcb->pending_iocb, j);
+            sys_free_mem(iocb);
+        }
+
+        if(dcb->ring != ring)
+            continue;
+
+        //Stop touching the buffer of the active operation, check_completed then starts the next one.
+        dcb->ring = NULL;
+        if(dcb->operation != IDLING)
+            complete_operation(dcb);
     }
-    return -1; //Should never happen.
+    irq_restore(flags);
 }
 
 extern void serial_isr(void*);
 
 /**
- * @brief The first level interrupt service routine for serial interrupts.
+ * @brief Finds the appropriate IRQ for the given device.
+ * @param dev the device.
+ * @return the IRQ number.
  */
-void serial_isr_intern(void)
+int find_com_irq(device dev)
 {
-    device dev = COM1; //FIXME make this actually work with other COM types.
-    int dcb_ind = serial_devno(dev);
-    dcb_t *dcb = device_controllers + dcb_ind;
+    return dev == COM1 || dev == COM3 ? 4 : 3;
+}
+
+/**
+ * @brief Finds the device interrupt vector.
+ * @param dev the device vector.
+ * @return the IV number.
+ */
+int find_com_iv(device dev)
+{
+    return dev == COM1 || dev == COM3 ? 0x24 : 0x23;
+}
+
+/**
+ * @brief Services the pending interrupt of a single port.
+ * @param dcb the port's DCB.
+ * @return true if the port had an interrupt pending, false if it had nothing to service.
+ */
+static bool service_port(dcb_t *dcb)
+{
+    device dev = dcb->dev;
 
     //Get and switch on the interrupt ID.
-    int interrupt_id = inb(dev + IIR) & 0b111;
-    if((interrupt_id & 1) != 0) //Not caused by us in this case.
-        return;
+    int interrupt_id = inb(dev + IIR) & 0b1111;
+    if((interrupt_id & 1) != 0) //Not caused by this port in this case.
+        return false;
     interrupt_id >>= 1;
 
     switch (interrupt_id)
     {
         case 0b00: //Binary 00 = 0
         {
-            inb(dev + MSR);
+            dcb->stats.interrupts[SERIAL_IRQ_MODEM]++;
+            //CTS is the other side letting this one send.
+            int msr = inb(dev + MSR);
+            if(dcb->config.flow == SERIAL_FLOW_RTSCTS)
+                set_stopped(dcb, (msr & 0x10) == 0);
             break;
         }
         case 0b01: //Binary 01 = 1
         {
+            dcb->stats.interrupts[SERIAL_IRQ_TX]++;
             output_isr(dcb);
             break;
         }
         case 0b10: //Binary 10 = 2
         {
-            input_isr(dcb);
+            dcb->stats.interrupts[SERIAL_IRQ_RX]++;
+            input_isr(dcb, false);
             break;
         }
         case 0b11: //Binary 11 = 3
         {
-            inb(dev + LSR); //Read and throw away.
+            dcb->stats.interrupts[SERIAL_IRQ_LINE]++;
+            line_status(dcb); //Read and count overruns.
+            break;
+        }
+        case 0b110: //Binary 110 = 6, bytes sat in the FIFO under the threshold.
+        {
+            dcb->stats.interrupts[SERIAL_IRQ_TIMEOUT]++;
+            input_isr(dcb, true);
             break;
         }
         default: {} //No other interrupts should happen.
     }
-
-    outb(0x20, 0x20);
+    return true;
 }
 
 /**
- * @brief Finds the appropriate IRQ for the given device.
- * @param dev the device.
- * @return the IRQ number.
+ * @brief The first level interrupt service routine for serial interrupts, shared by IRQ 3 and 4.
+ * Every open port is serviced until none of them have anything pending, so an interrupt raised
+ * on one port while another is being serviced isn't lost.
+ * @param ctx the context of the interrupted process.
+ * @return the context to resume once the interrupt is finished.
  */
-int find_com_irq(device dev)
+struct context *serial_isr_intern(struct context *ctx)
 {
-    return dev == COM1 || dev == COM3 ? 4 : 3;
-}
+    kernel_lock();
+    unsigned long long entered_at = rdtsc();
+    idle_irq_entry();
 
-/**
- * @brief Finds the device interrupt vector.
- * @param dev the device vector.
- * @return the IV number.
- */
-int find_com_iv(device dev)
-{
-    return dev == COM1 || dev == COM3 ? 0x24 : 0x23;
+    bool serviced;
+    int passes = 0;
+    do
+    {
+        serviced = false;
+        for (size_t i = 0; i < sizeof(device_controllers) / sizeof(device_controllers[0]); ++i)
+        {
+            dcb_t *dcb = device_controllers + i;
+            if(dcb->allocated && service_port(dcb))
+                serviced = true;
+        }
+    } while (serviced && ++passes < SERIAL_ISR_MAX_PASSES);
+
+    //IRQ 3 and 4 are both on the master PIC, so either one's EOI does.
+    intctl_eoi(find_com_irq(COM1), entered_at);
+
+    //Switch straight to a PCB whose IO just completed, if allowed.
+    return irq_reschedule(ctx);
 }
 
-int serial_open(device dev, int speed)
+int serial_open(device dev, int speed, size_t rx_size, size_t tx_size)
 {
     int dcb_index = serial_devno(dev);
     if(dcb_index == -1)
@@ -759,18 +1937,23 @@ int serial_open(device dev, int speed)
         return code_selection(-103);
     }
 
-    if (speed == 0){
+    if (!valid_baud(speed)){
         return code_selection(-102);
     }
 
+    if(!spsc_init(&dcb->rx_ring, rx_size))
+        return -1;
+
+    if(!spsc_init(&dcb->tx_ring, tx_size))
+    {
+        spsc_destroy(&dcb->rx_ring);
+        return -1;
+    }
+
     dcb->dev = dev;
     dcb->allocated = true;
     dcb->event = false;
     dcb->operation = IDLING;
-    dcb->r_buffer_len = RING_BUFFER_LEN;
-    dcb->r_buffer_size = 0;
-    dcb->r_buffer_start = sys_alloc_mem(RING_BUFFER_LEN);
-    dcb->read_index = dcb->write_index = 0;
     dcb->pending_iocb = nl_unbounded();
 
     int com_irq = find_com_irq(dev);
@@ -778,22 +1961,21 @@ int serial_open(device dev, int speed)
 
     idt_install(com_iv, serial_isr);
 
-    int brd = 115200 / speed; //Standard is 19200 Generally
+    //Keep the line settings from serial_init or serial_configure, at the requested speed.
+    if(dcb->config.baud == 0)
+        dcb->config = default_config;
+    dcb->config.baud = speed;
+    apply_config(dev, &dcb->config);
 
-    //Install the DCB to the PIC.
-    outb(dev + LCR, 0x80);    //set line control register
-    outb(dev + DLL, brd & (0xFF));    //set bsd least sig bit
-    outb(dev + DLM, brd & (0xFF00));    //brd most significant bit
-    outb(dev + LCR, 0x03);    //lock divisor; 8bits, no parity, one stop
-
-    cli();
-    int mask = inb(0x21);
-    mask &= ~(1 << (com_irq));
-    outb(0x21, mask);
-    sti();
+    //Install the DCB to the interrupt controller.
+    intctl_enable_irq(com_irq);
     //Note to Later --IMPLEMENT ERROR CODES 101,102,103
-    outb(dev + MCR, 0x08);
+    outb(dev + MCR, 0x0B);
     outb(dev + IER, 0x01);
+    memset(&dcb->flow, 0, sizeof(dcb->flow));
+    memset(&dcb->stats, 0, sizeof(dcb->stats));
+    dcb->flow_char = 0;
+    apply_flow(dcb);
     initialized[dcb_index] = 1;
     return 0;
 }
@@ -809,12 +1991,13 @@ int serial_close(device dev)
         return code_selection(-201); //Throw Error Serial port not open
 
     destroy_list(dcb->pending_iocb, true);
+
+    //Whatever was written behind still goes out before the port is shut.
+    tx_flush(dcb);
+    spsc_destroy(&dcb->tx_ring);
+    spsc_destroy(&dcb->rx_ring);
     dcb->allocated = 0;
-    cli();
-    int mask = inb(0x21);
-    mask |= (1 << (find_com_irq(dev)));
-    outb(0x21, mask);
-    sti();
+    intctl_disable_irq(find_com_irq(dev));
 
     //Disable modem control and interrupt enable.
     outb(dev + MCR, 0x00);
@@ -848,37 +2031,64 @@ int serial_read(device dev, char *buf, size_t len)
     dcb->event = false;
     dcb->io_buffer = buf;
     dcb->io_bytes = dcb->line_pos = 0;
+    dcb->segments_left = dcb->vec_done = 0;
     dcb->io_requested = len;
+    dcb->echo_len = dcb->echo_pos = 0;
+    dcb->echo_dirty = ECHO_CLEAN;
+    dcb->echo_cmd_exists = false;
     // setting status to 'reading'
     dcb->operation = READING;
+
+    //Raw reads skip the line editing, and only wait if nothing has arrived yet.
+    if(dcb->mode == SERIAL_RAW)
+    {
+        dcb->io_bytes = spsc_read(&dcb->rx_ring, buf, len);
+        check_unthrottle(dcb);
+        if(dcb->io_bytes == 0 && !dcb->nonblocking)
+            return 0;
+
+        complete_operation(dcb);
+        return (int) dcb->io_bytes;
+    }
     
-    //Read all available things from ring buffer.
-    while(dcb->r_buffer_size > 0 &&
-          dcb->io_bytes < dcb->io_requested &&
-          !is_newline(dcb->io_buffer[dcb->io_bytes]))
+    //Read all available things from ring buffer, up to the end of a line.
+    bool line_ended = false;
+    char read;
+    while(dcb->io_bytes < dcb->io_requested && spsc_pop(&dcb->rx_ring, &read))
     {
-        char read = dcb->r_buffer_start[dcb->read_index];
-        dcb->read_index = (dcb->read_index + 1) % RING_BUFFER_LEN;
+        line_ended = is_newline(read);
+        if(line_ended)
+            break;
 
         handle_new_char(read, dcb);
-        dcb->r_buffer_size--;
     }
+    check_unthrottle(dcb);
 
     if(dcb->io_bytes > 0)
-        echo_line(dcb->io_buffer, dcb, 0);
+        echo_update(dcb);
 
     //Check if we're done.
-    if(dcb->io_bytes == dcb->io_requested || is_newline(dcb->io_buffer[dcb->io_bytes]))
+    if(dcb->io_bytes == dcb->io_requested || line_ended)
     {
-        dcb->operation = IDLING;
-        dcb->event = true;
+        if(line_ended)
+            serial_out(dev, "\n", 1);
+        complete_operation(dcb);
         return (int) dcb->io_bytes;
     }
 
     return 0; //Signifies we need more characters.
 }
 
-int serial_write(device dev, char *buf, size_t len)
+/**
+ * @brief Starts writing the buffer, followed by any further segments.
+ * @param dev the device to write to.
+ * @param buf the first buffer.
+ * @param len the length of the first buffer.
+ * @param rest the segments to write after it, or NULL.
+ * @param rest_count the amount of segments after it.
+ * @return 0 on success, negative values on error.
+ */
+static int start_write(device dev, char *buf, size_t len, const io_segment_t *rest, size_t rest_count)
 {
     int dcb_ind = serial_devno(dev);
     if(dcb_ind == -1)
@@ -904,20 +2114,43 @@ int serial_write(device dev, char *buf, size_t len)
 
     // install buffer pointer and counter, and set current status to writing
     dcb->io_buffer = buf;
-    dcb->io_bytes = 1;
+    dcb->io_bytes = 0;
     dcb->io_requested = len;
+    dcb->segments = rest;
+    dcb->segments_left = rest_count;
+    dcb->vec_done = 0;
     dcb->event = false;
     dcb->operation = WRITING;
    
-    // get first character from request buff and store it in output register
-    outb(dev, buf[0]);
-
-    //Enable the interrupts.
-    int previous = inb(dev + IER);
-    outb(dev + IER, previous | 0x02);
+    //Copy what fits behind the output already waiting, the interrupt moves the rest as it drains.
+    refill_tx_ring(dcb);
+    tx_kick(dcb);
     return 0;
 }
 
+int serial_write(device dev, char *buf, size_t len)
+{
+    return start_write(dev, buf, len, NULL, 0);
+}
+
+int serial_writev(device dev, const io_segment_t *segments, size_t count)
+{
+    if(segments == NULL)
+        return code_selection(-402);
+
+    //The first segment is started like a normal write, so it can't be empty.
+    while(count > 0 && segments->length == 0)
+    {
+        segments++;
+        count--;
+    }
+
+    if(count == 0)
+        return code_selection(-403);
+
+    return start_write(dev, (char *) segments->base, segments->length, segments + 1, count - 1);
+}
+
 ///The CLI history from the serial_poll function.
 static linked_list *cli_history = NULL;
 
@@ -953,7 +2186,7 @@ int serial_poll(device dev, char *buffer, size_t len)
 
     if(prompt != NULL)
     {
-        serial_out(COM1, prompt, strlen(prompt));
+        serial_out(dev, prompt, strlen(prompt));
     }
 
     while (bytes_read < len)
@@ -1217,11 +2450,11 @@ int serial_poll(device dev, char *buffer, size_t len)
             cmd_exists = command_exists(buffer);
             if(cmd_exists)
             {
-                internal_soc(get_color("bright-green"));
+                internal_soc(dev, get_color("bright-green"));
             }
             else
             {
-                internal_soc(get_color("red"));
+                internal_soc(dev, get_color("red"));
             }
         }
 
@@ -1236,7 +2469,7 @@ int serial_poll(device dev, char *buffer, size_t len)
 
         if(command_formatting_enabled)
         {
-            internal_soc(clr);
+            internal_soc(dev, clr);
         }
     }
 
@@ -0,0 +1,431 @@
+#include "mpx/smp.h"
+#include "mpx/apic.h"
+#include "mpx/gdt.h"
+#include "mpx/timer.h"
+#include "mpx/interrupts.h"
+#include "mpx/pcb.h"
+#include "mpx/sys_call.h"
+#include "mpx/fpu.h"
+#include "mpx/panic.h"
+#include "sys_req.h"
+#include "string.h"
+
+/**
+ * @file smp.c
+ * @brief Contains the discovery and start up of the application processors, and the kernel lock.
+ */
+
+///The physical address the start up code is copied to, it has to be page aligned and below 1MB.
+#define TRAMPOLINE_ADDR 0x8000
+///The stack size of each application processor, which it calls into the kernel with once.
+#define AP_STACK_SIZE 4096
+///The ticks to wait after an INIT IPI, at least 10ms.
+#define INIT_DELAY_TICKS 2
+///The ticks to wait for an application processor to come online.
+#define START_TIMEOUT_TICKS 10
+
+///The signature of the MP floating pointer structure, "_MP_".
+#define MP_FLOAT_SIGNATURE 0x5F504D5F
+///The signature of the MP configuration table, "PCMP".
+#define MP_CONFIG_SIGNATURE 0x504D4350
+///The processor entry type.
+#define MP_ENTRY_PROCESSOR 0
+///The length of a processor entry, every other entry is 8 bytes.
+#define MP_PROCESSOR_LENGTH 20
+///The enabled flag of a processor entry.
+#define MP_CPU_ENABLED 0x1
+///The boot processor flag of a processor entry.
+#define MP_CPU_BOOT 0x2
+
+///The vector an idle application processor is woken at.
+#define SMP_WAKE_IV 0x40
+
+///The MP floating pointer structure.
+struct mp_float {
+    uint32_t signature;
+    uint32_t config_addr;
+    uint8_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    uint8_t features[5];
+} __attribute__((packed));
+
+///The header of the MP configuration table.
+struct mp_config {
+    uint32_t signature;
+    uint16_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_addr;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} __attribute__((packed));
+
+///A processor entry of the MP configuration table.
+struct mp_processor {
+    uint8_t type;
+    uint8_t lapic_id;
+    uint8_t lapic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} __attribute__((packed));
+
+///The start up code and its parameters, from trampoline.s.
+extern char ap_trampoline[], ap_trampoline_end[];
+extern char ap_tramp_cr3[], ap_tramp_stack[], ap_tramp_entry[];
+extern void smp_wake_isr(void *);
+
+///Every CPU found, the boot CPU is the first until the MP table is read.
+static struct cpu cpus[SMP_MAX_CPUS] = {{.boot_cpu = true, .online = true}};
+///The amount of CPUs found.
+static int cpu_count = 0;
+///The stacks of the application processors.
+static uint8_t ap_stacks[SMP_MAX_CPUS][AP_STACK_SIZE] __attribute__((aligned(16)));
+///The CPU currently being started, which marks itself online.
+static struct cpu *volatile starting_cpu = NULL;
+///If the application processors may start scheduling.
+static volatile bool scheduling = false;
+///If a wake up was sent to each CPU that it hasn't taken yet.
+static volatile bool wake_pending[SMP_MAX_CPUS] = {0};
+
+///1 while a CPU holds the kernel lock.
+static volatile uint32_t lock_word = 0;
+///The index of the CPU holding the kernel lock, or -1.
+static volatile int lock_owner = -1;
+///How many times the holding CPU took the kernel lock.
+static int lock_depth = 0;
+
+/**
+ * @brief Sums the bytes of an MP structure.
+ * @param ptr the structure.
+ * @param len the length of the structure.
+ * @return the sum, which is 0 for a valid structure.
+ */
+static uint8_t checksum(const void *ptr, uint32_t len)
+{
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; ++i)
+        sum += ((const uint8_t *) ptr)[i];
+    return sum;
+}
+
+/**
+ * @brief Looks for the MP floating pointer structure in the given range.
+ * @param start the start of the range, 16 byte aligned.
+ * @param len the length of the range.
+ * @return the structure, or NULL if it isn't there.
+ */
+static const struct mp_float *find_mp_float(uint32_t start, uint32_t len)
+{
+    for (uint32_t addr = start; addr < start + len; addr += 16)
+    {
+        const struct mp_float *mp = (const struct mp_float *) addr;
+        if (mp->signature == MP_FLOAT_SIGNATURE && checksum(mp, mp->length * 16) == 0)
+            return mp;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads the processors out of the MP configuration table.
+ * @return true if the table was found and uses the expected local APIC address.
+ */
+static bool read_mp_table(void)
+{
+    //The BIOS data area's EBDA pointer lives in the unmapped first page, so the last KB of base
+    //memory (where QEMU's EBDA is) is searched instead, followed by the BIOS ROM.
+    const struct mp_float *mp = find_mp_float(0x9FC00, 0x400);
+    if (mp == NULL)
+        mp = find_mp_float(0xF0000, 0x10000);
+    if (mp == NULL || mp->config_addr == 0)
+        return false;
+
+    const struct mp_config *config = (const struct mp_config *) mp->config_addr;
+    if (config->signature != MP_CONFIG_SIGNATURE || checksum(config, config->length) != 0 ||
+        config->lapic_addr != LAPIC_BASE)
+        return false;
+
+    const uint8_t *entry = (const uint8_t *) (config + 1);
+    for (uint16_t i = 0; i < config->entry_count; ++i)
+    {
+        if (*entry != MP_ENTRY_PROCESSOR)
+        {
+            entry += 8;
+            continue;
+        }
+
+        const struct mp_processor *proc = (const struct mp_processor *) entry;
+        if ((proc->flags & MP_CPU_ENABLED) && cpu_count < SMP_MAX_CPUS)
+        {
+            cpus[cpu_count].lapic_id = proc->lapic_id;
+            cpus[cpu_count].boot_cpu = (proc->flags & MP_CPU_BOOT) != 0;
+            cpus[cpu_count].online = cpus[cpu_count].boot_cpu;
+            cpu_count++;
+        }
+        entry += MP_PROCESSOR_LENGTH;
+    }
+    return true;
+}
+
+/**
+ * @brief Waits for the given amount of system ticks.
+ * @param count the ticks.
+ */
+static void wait_ticks(unsigned int count)
+{
+    unsigned int start = get_ticks();
+    while (get_ticks() - start < count)
+        __asm__ volatile ("pause");
+}
+
+/**
+ * @brief The first C code an application processor runs, called by the trampoline.
+ * It loads the kernel's GDT and IDT, enables its local APIC and FPU, reports in and waits for
+ * the boot CPU to start scheduling. Then it dispatches its first process.
+ */
+void ap_main(void)
+{
+    gdt_init();
+    idt_init();
+    lapic_enable();
+    fpu_init_cpu();
+    starting_cpu->online = true;
+
+    //The boot CPU sets up the PCB queue without the kernel lock.
+    while (!scheduling)
+        __asm__ volatile ("pause");
+
+    //This context is never returned to, the CPU always has its idle process to fall back on.
+    __asm__ volatile ("int $0x60" :: "a"(IDLE));
+    kpanic("An application processor returned to its start up code");
+}
+
+/**
+ * @brief The idle process of an application processor. It halts until woken by smp_wake_idle,
+ * whose interrupt handler switches to the ready process.
+ */
+static void ap_idle_process(void)
+{
+    for (;;)
+        __asm__ volatile ("sti\n\thlt");
+}
+
+/**
+ * @brief The C half of the wake up interrupt handler.
+ * @param ctx the context of the interrupted process.
+ * @return the context to resume.
+ */
+struct context *smp_wake_intern(struct context *ctx)
+{
+    kernel_lock();
+    wake_pending[smp_cpu_index()] = false;
+    lapic_write(LAPIC_EOI, 0);
+    return irq_reschedule(ctx);
+}
+
+/**
+ * @brief Sets the value of one of the trampoline's parameters, in its copy.
+ * @param param the parameter, in the original trampoline.
+ * @param value the value.
+ */
+static void set_trampoline_param(char *param, uint32_t value)
+{
+    *(volatile uint32_t *) (TRAMPOLINE_ADDR + (param - ap_trampoline)) = value;
+}
+
+/**
+ * @brief Starts an application processor with the INIT, startup, startup sequence.
+ * @param cpu the CPU.
+ * @param stack the top of its stack.
+ * @return true if it came online.
+ */
+static bool start_ap(struct cpu *cpu, uint8_t *stack)
+{
+    set_trampoline_param(ap_tramp_stack, (uint32_t) stack);
+    starting_cpu = cpu;
+
+    lapic_send_ipi(cpu->lapic_id, LAPIC_IPI_INIT);
+    wait_ticks(INIT_DELAY_TICKS);
+
+    for (int attempt = 0; attempt < 2 && !cpu->online; ++attempt)
+    {
+        lapic_send_ipi(cpu->lapic_id, LAPIC_IPI_STARTUP | (TRAMPOLINE_ADDR >> 12));
+        wait_ticks(1);
+    }
+
+    unsigned int start = get_ticks();
+    while (!cpu->online && get_ticks() - start < START_TIMEOUT_TICKS)
+        __asm__ volatile ("pause");
+    return cpu->online;
+}
+
+int smp_init(void)
+{
+    unsigned int flags = irq_save();
+    bool found = lapic_present() && read_mp_table() && cpu_count >= 2;
+    //An interrupt may have left the kernel lock with the boot CPU, which needn't be first in the table.
+    if (found && lock_owner != -1)
+        lock_owner = smp_cpu_index();
+    irq_restore(flags);
+
+    if (!found)
+    {
+        //The boot CPU is all there is.
+        cpu_count = 1;
+        cpus[0].boot_cpu = true;
+        cpus[0].online = true;
+        return 0;
+    }
+
+    lapic_enable();
+    idt_install(SMP_WAKE_IV, smp_wake_isr);
+
+    uint32_t cr3;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(cr3));
+    memcpy((void *) TRAMPOLINE_ADDR, ap_trampoline, ap_trampoline_end - ap_trampoline);
+    set_trampoline_param(ap_tramp_cr3, cr3);
+    set_trampoline_param(ap_tramp_entry, (uint32_t) &ap_main);
+
+    int started = 0;
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        if (cpus[i].boot_cpu)
+            continue;
+
+        if (start_ap(&cpus[i], ap_stacks[i] + AP_STACK_SIZE))
+            started++;
+    }
+    return started;
+}
+
+int smp_cpu_count(void)
+{
+    return cpu_count == 0 ? 1 : cpu_count;
+}
+
+const struct cpu *smp_get_cpu(int index)
+{
+    return &cpus[index];
+}
+
+int smp_cpu_index(void)
+{
+    if (cpu_count < 2)
+        return 0;
+
+    uint8_t id = lapic_id();
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        if (cpus[i].lapic_id == id)
+            return i;
+    }
+    return 0;
+}
+
+struct cpu *smp_this_cpu(void)
+{
+    return &cpus[smp_cpu_index()];
+}
+
+void smp_start_scheduling(void)
+{
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        if (cpus[i].boot_cpu || !cpus[i].online)
+            continue;
+
+        //The idle process is created like any other, then taken out of the queue so only its CPU runs it.
+        char name[] = "idle0";
+        name[4] = (char) ('0' + i);
+        if (!generate_new_pcb(name, 9, SYSTEM, ap_idle_process, NULL, 0, 0))
+            kpanic("Couldn't create an application processor's idle process");
+        cpus[i].idle = pcb_find(name);
+        pcb_remove(cpus[i].idle);
+    }
+    scheduling = true;
+}
+
+bool smp_running(void)
+{
+    if (!scheduling)
+        return false;
+
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        if (!cpus[i].boot_cpu && cpus[i].idle != NULL)
+            return true;
+    }
+    return false;
+}
+
+void smp_wake_idle(void)
+{
+    if (!scheduling)
+        return;
+
+    int self = smp_cpu_index();
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        struct cpu *cpu = &cpus[i];
+        if (i == self || cpu->idle == NULL || cpu->active != cpu->idle || wake_pending[i])
+            continue;
+
+        wake_pending[i] = true;
+        lapic_send_ipi(cpu->lapic_id, LAPIC_IPI_FIXED | SMP_WAKE_IV);
+        return;
+    }
+}
+
+void kernel_lock(void)
+{
+    int self = smp_cpu_index();
+    if (lock_owner == self)
+    {
+        lock_depth++;
+        return;
+    }
+
+    uint32_t taken = 1;
+    for (;;)
+    {
+        __asm__ volatile ("xchg %0, %1" : "+r"(taken), "+m"(lock_word) :: "memory");
+        if (taken == 0)
+            break;
+
+        //Spin on a plain read, so the cache line isn't bounced between the waiting CPUs.
+        while (lock_word != 0)
+            __asm__ volatile ("pause");
+        taken = 1;
+    }
+    lock_owner = self;
+    lock_depth = 1;
+}
+
+void kernel_unlock(void)
+{
+    if (--lock_depth > 0)
+        return;
+
+    lock_owner = -1;
+    __asm__ volatile ("" ::: "memory");
+    lock_word = 0;
+}
+
+void kernel_exit(void)
+{
+    struct cpu *cpu = smp_this_cpu();
+    struct pcb *active = cpu->active;
+
+    //Whatever is resumed runs at the bottom of the kernel entry, one level deep at most.
+    lock_depth = 1;
+    if (active != NULL && (active->process_class != SYSTEM || active == cpu->idle))
+        kernel_unlock();
+}
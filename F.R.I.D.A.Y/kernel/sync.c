@@ -0,0 +1,216 @@
+#include "stddef.h"
+#include "mpx/wait_queue.h"
+
+/**
+ * @file sync.c
+ * @brief Contains the kernel side of wait queues, semaphores and mutexes.
+ */
+
+///The first of every parked PCB, linked through parked_next.
+static struct pcb *parked_head = NULL;
+
+void wait_queue_push(wait_queue_t *wq, struct pcb *pcb_ptr)
+{
+    pcb_ptr->waiting_on = wq;
+    pcb_ptr->wait_next = NULL;
+    if(wq->tail == NULL)
+        wq->head = pcb_ptr;
+    else
+        wq->tail->wait_next = pcb_ptr;
+    wq->tail = pcb_ptr;
+
+    //Keep track of it so it can still be found by name.
+    pcb_ptr->parked_prev = NULL;
+    pcb_ptr->parked_next = parked_head;
+    if(parked_head != NULL)
+        parked_head->parked_prev = pcb_ptr;
+    parked_head = pcb_ptr;
+}
+
+/**
+ * @brief Forgets the PCB as parked, after it has been taken out of its wait queue.
+ * @param pcb_ptr the PCB.
+ */
+static void forget_parked(struct pcb *pcb_ptr)
+{
+    if(pcb_ptr->parked_prev != NULL)
+        pcb_ptr->parked_prev->parked_next = pcb_ptr->parked_next;
+    else
+        parked_head = pcb_ptr->parked_next;
+    if(pcb_ptr->parked_next != NULL)
+        pcb_ptr->parked_next->parked_prev = pcb_ptr->parked_prev;
+
+    pcb_ptr->parked_prev = pcb_ptr->parked_next = NULL;
+    pcb_ptr->waiting_on = NULL;
+    pcb_ptr->wait_next = NULL;
+}
+
+struct pcb *wait_queue_wake(wait_queue_t *wq)
+{
+    struct pcb *pcb_ptr = wq->head;
+    if(pcb_ptr == NULL)
+        return NULL;
+
+    wq->head = pcb_ptr->wait_next;
+    if(wq->head == NULL)
+        wq->tail = NULL;
+    forget_parked(pcb_ptr);
+
+    pcb_ptr->exec_state = READY;
+    pcb_insert(pcb_ptr);
+    return pcb_ptr;
+}
+
+bool wait_queue_unpark(struct pcb *pcb_ptr)
+{
+    wait_queue_t *wq = pcb_ptr->waiting_on;
+    if(wq == NULL)
+        return false;
+
+    //Unlink it from the middle of the queue, this only happens when a parked PCB is deleted.
+    struct pcb *prev = NULL;
+    struct pcb *curr = wq->head;
+    while(curr != NULL && curr != pcb_ptr)
+    {
+        prev = curr;
+        curr = curr->wait_next;
+    }
+    if(curr == NULL)
+        return false;
+
+    if(prev == NULL)
+        wq->head = curr->wait_next;
+    else
+        prev->wait_next = curr->wait_next;
+    if(wq->tail == curr)
+        wq->tail = prev;
+
+    forget_parked(pcb_ptr);
+    return true;
+}
+
+struct pcb *next_parked_pcb(struct pcb *prev)
+{
+    return prev == NULL ? parked_head : prev->parked_next;
+}
+
+/**
+ * @brief Makes the PCB the owner of the free mutex.
+ * @param mutex the mutex.
+ * @param owner the new owner, or NULL to leave it free.
+ */
+static void mutex_take(mutex_t *mutex, struct pcb *owner)
+{
+    mutex->owner = owner;
+    if(owner == NULL)
+        return;
+
+    mutex->next_held = owner->held_mutexes;
+    owner->held_mutexes = mutex;
+}
+
+/**
+ * @brief Releases the mutex, handing it to the first waiter if there is one.
+ * @param mutex the mutex.
+ */
+static void mutex_release(mutex_t *mutex)
+{
+    //Unlink it from its owner's held mutexes.
+    mutex_t **link = &mutex->owner->held_mutexes;
+    while(*link != NULL && *link != mutex)
+        link = &(*link)->next_held;
+    if(*link != NULL)
+        *link = mutex->next_held;
+    mutex->next_held = NULL;
+
+    //Ownership goes straight to the woken PCB, so nothing can barge in before it runs.
+    mutex_take(mutex, wait_queue_wake(&mutex->waiters));
+}
+
+void mutex_release_all(struct pcb *pcb_ptr)
+{
+    while(pcb_ptr->held_mutexes != NULL)
+        mutex_release(pcb_ptr->held_mutexes);
+}
+
+wait_queue_t *sync_request(op_code action, void *object, void *arg, struct pcb *caller, struct context *ctx)
+{
+    if(object == NULL || caller == NULL)
+    {
+        ctx->eax = INVALID_OPERATION;
+        return NULL;
+    }
+
+    switch (action)
+    {
+        case SEM_WAIT:
+        {
+            semaphore_t *sem = object;
+            if(sem->count > 0)
+            {
+                sem->count--;
+                return NULL;
+            }
+            return &sem->waiters;
+        }
+        case SEM_SIGNAL:
+        {
+            //The unit is handed directly to a waiter, if there is one.
+            semaphore_t *sem = object;
+            if(wait_queue_wake(&sem->waiters) == NULL)
+                sem->count++;
+            return NULL;
+        }
+        case MUTEX_LOCK:
+        {
+            mutex_t *mutex = object;
+            if(mutex->owner == NULL)
+            {
+                mutex_take(mutex, caller);
+                return NULL;
+            }
+
+            //Locking it twice would never return.
+            if(mutex->owner == caller)
+            {
+                ctx->eax = INVALID_OPERATION;
+                return NULL;
+            }
+            return &mutex->waiters;
+        }
+        case MUTEX_UNLOCK:
+        {
+            mutex_t *mutex = object;
+            if(mutex->owner != caller)
+            {
+                ctx->eax = INVALID_OPERATION;
+                return NULL;
+            }
+            mutex_release(mutex);
+            return NULL;
+        }
+        case WQ_WAIT:
+        {
+            mutex_t *mutex = arg;
+            if(mutex != NULL)
+            {
+                if(mutex->owner != caller)
+                {
+                    ctx->eax = INVALID_OPERATION;
+                    return NULL;
+                }
+                mutex_release(mutex);
+            }
+            return object;
+        }
+        case WQ_NOTIFY:
+            wait_queue_wake(object);
+            return NULL;
+        case WQ_NOTIFY_ALL:
+            while(wait_queue_wake(object) != NULL);
+            return NULL;
+        default:
+            ctx->eax = INVALID_OPERATION;
+            return NULL;
+    }
+}
@@ -3,27 +3,50 @@
 #include "linked_list.h"
 #include "mpx/device.h"
 #include "mpx/serial.h"
+#include "mpx/alarm.h"
+#include "mpx/sys_call.h"
+#include "mpx/wait_queue.h"
+#include "mpx/ipc.h"
+#include "mpx/aio.h"
+#include "mpx/timer.h"
+#include "mpx/sched.h"
+#include "mpx/fpu.h"
+#include "mpx/smp.h"
 
 /**
  * @file sys_call.c
  * @brief This file contains the sys_call function which is used to do context switching.
  */
 
-///The currently running PCB.
-static struct pcb *active_pcb_ptr = NULL;
-///The first context saved when sys_call is called.
-static struct context *first_context_ptr = NULL;
-
 /**
  * @brief Gets the next PCB to replace the current one. The PCB can be sourced from one of two locations. They're listed in the order they're checked.
  * 1. The DCB queues. If a process is loaded from there, it means that its IO operation was finished.
  * 2. The PCB queue. If no such PCB is done in the DCBs, a PCB is polled from the PCB queue. If no PCB is available, NULL returns.
  * In either case, the PCB is prepared for running by removing it from wherever it is in the PCB queue and set to a 'RUNNING' state.
+ * An application processor only takes user processes from the PCB queue, the DCB queues are left to the boot CPU.
  *
  * @return the next PCB to load, or NULL if no such PCB exists.
  */
 struct pcb *get_next_pcb()
 {
+    //Wake the alarm dispatcher if an alarm has expired, and any sleepers that are due.
+    alarm_check();
+    sleep_check();
+
+    //Move every MLFQ process back to the top level if it's time to.
+    sched_check();
+
+    //Start anything processes queued in their rings since the last pass.
+    io_ring_poll();
+
+    if (!smp_this_cpu()->boot_cpu)
+    {
+        struct pcb *user_pcb = poll_next_pcb_of(USER);
+        if (user_pcb != NULL)
+            user_pcb->exec_state = RUNNING;
+        return user_pcb;
+    }
+
     //First, we need to check for completed IO operations.
     struct pcb *to_load = check_completed();
     if (to_load != NULL)
@@ -52,6 +75,47 @@ struct pcb *get_next_pcb()
     return queue_pcb;
 }
 
+/**
+ * @brief Gets the next PCB for a process that can't keep running. An application processor
+ * switches to its idle process when no user process is ready.
+ * @return the next PCB to load, or NULL if no such PCB exists.
+ */
+static struct pcb *next_or_idle(void)
+{
+    struct pcb *to_load = get_next_pcb();
+    struct cpu *cpu = smp_this_cpu();
+    if (to_load == NULL && !cpu->boot_cpu && cpu->active != cpu->idle)
+    {
+        to_load = cpu->idle;
+        to_load->exec_state = RUNNING;
+    }
+    return to_load;
+}
+
+/**
+ * @brief Updates the accounting of both PCBs when switching from one to the other.
+ * @param from the PCB giving up the CPU, or NULL.
+ * @param to the PCB being dispatched.
+ * @param voluntary if the PCB giving up the CPU has to wait for something.
+ */
+static void account_switch(struct pcb *from, struct pcb *to, bool voluntary)
+{
+    unsigned long long now = rdtsc();
+    if (from != NULL)
+    {
+        from->stats.run_cycles += now - from->stats.dispatched_at;
+        if (voluntary)
+            from->stats.voluntary_switches++;
+        else
+            from->stats.involuntary_switches++;
+    }
+
+    to->stats.dispatches++;
+    to->stats.dispatched_at = now;
+    sched_dispatched(to, now);
+    fpu_switch(to);
+}
+
 /**
  * @brief Want to check if next PCB is blocked, unblocked, IDLE, NULL, etc
  * @param next_pcb the next PCB to load.
@@ -65,14 +129,20 @@ struct context *next_pcb(struct pcb *next_pcb, struct context *current_context,
     if(next_pcb == NULL)
         return current_context;
 
-    struct pcb *present_pcb = active_pcb_ptr;
-    active_pcb_ptr = next_pcb;
+    struct cpu *cpu = smp_this_cpu();
+    struct pcb *present_pcb = cpu->active;
+    account_switch(current_context != NULL ? present_pcb : NULL, next_pcb, next_state == BLOCKED);
+    cpu->active = next_pcb;
     struct context *new_ctx = (struct context *) next_pcb->stack_ptr;
     //Checks to see if the active pointer pcb is null
     if (present_pcb != NULL && current_context != NULL)
     {
         present_pcb->exec_state = next_state;
-        pcb_insert(present_pcb);
+        //Only IO requests block through here, parked PCBs go through park_pcb.
+        sched_switched_out(present_pcb, next_state == BLOCKED);
+        //An application processor's idle process stays out of the queue, so no other CPU runs it.
+        if (cpu->boot_cpu || present_pcb != cpu->idle)
+            pcb_insert(present_pcb);
         //Update where the PCB's context pointer is pointing.
         present_pcb->stack_ptr = current_context;
     }
@@ -80,67 +150,196 @@ struct context *next_pcb(struct pcb *next_pcb, struct context *current_context,
 }
 
 /**
- * @brief The main system call function, implementing the IDLE and EXIT system requests.
+ * @brief Parks the active PCB in the wait queue and switches to the next PCB. Unlike a PCB
+ * blocked on IO, a parked PCB is kept out of the PCB queue until it is woken.
+ * @param next_pcb the next PCB to load.
+ * @param current_context the current context.
+ * @param wq the wait queue to park in.
+ * @return Pointer to the next context struct
+ */
+static struct context *park_pcb(struct pcb *next_pcb, struct context *current_context, wait_queue_t *wq)
+{
+    //Nothing else could run, which can't happen while the idle process exists.
+    struct cpu *cpu = smp_this_cpu();
+    if(next_pcb == NULL || cpu->active == NULL)
+    {
+        current_context->eax = INVALID_OPERATION;
+        return current_context;
+    }
+
+    struct pcb *present_pcb = cpu->active;
+    account_switch(present_pcb, next_pcb, true);
+    present_pcb->exec_state = BLOCKED;
+    present_pcb->stack_ptr = current_context;
+    sched_switched_out(present_pcb, false);
+    wait_queue_push(wq, present_pcb);
+
+    cpu->active = next_pcb;
+    return (struct context *) next_pcb->stack_ptr;
+}
+
+/**
+ * @brief Checks if the first ready PCB in the queue should run before the PCB.
+ * @param pcb_ptr the running PCB.
+ * @return true if the queue holds a PCB that outranks it.
+ */
+static bool ready_outranks(struct pcb *pcb_ptr)
+{
+    struct pcb *queue_pcb = peek_next_pcb();
+    return queue_pcb != NULL && queue_pcb->exec_state == READY && queue_pcb->dispatch_state != SUSPENDED
+           && sched_compare(queue_pcb, pcb_ptr) < 0;
+}
+
+/**
+ * @brief Returns to the caller of a request that didn't block, unless a PCB that outranks it is
+ * ready or an IO completion may have made one ready. Only then is the scheduler consulted.
+ * @param ctx the caller's context.
+ * @return a pointer to the next context to load.
+ */
+static struct context *resume_caller(struct context *ctx)
+{
+    struct cpu *cpu = smp_this_cpu();
+    struct pcb *active_pcb_ptr = cpu->active;
+    bool completion = cpu->boot_cpu && io_completion_pending();
+    if (active_pcb_ptr == NULL || (!completion && !ready_outranks(active_pcb_ptr)))
+        return ctx;
+
+    struct pcb *to_load = get_next_pcb();
+    if (to_load == NULL)
+        return ctx;
+
+    //A PCB whose IO completed may still not outrank the caller, so it waits its turn.
+    if (sched_compare(to_load, active_pcb_ptr) >= 0)
+    {
+        to_load->exec_state = READY;
+        pcb_insert(to_load);
+        return ctx;
+    }
+    return next_pcb(to_load, ctx, READY);
+}
+
+struct pcb *get_active_pcb(void)
+{
+    return smp_this_cpu()->active;
+}
+
+void set_idle_pcb(struct pcb *pcb_ptr)
+{
+    smp_this_cpu()->idle = pcb_ptr;
+}
+
+struct context *irq_reschedule(struct context *ctx)
+{
+    //Any other process could have been interrupted in the middle of the heap or queue code,
+    //so only the idle process (which every woken PCB outranks) is preempted.
+    struct cpu *cpu = smp_this_cpu();
+    if (cpu->active == NULL || cpu->active != cpu->idle)
+        return ctx;
+
+    return next_pcb(get_next_pcb(), ctx, READY);
+}
+
+/**
+ * @brief The main system call function. Requests that don't block or yield return straight to
+ * the caller, the scheduler is only consulted when a switch is actually needed: when the caller
+ * blocks, yields, woke a PCB that outranks it or an IO completion is waiting to be handled.
+ * Takes the kernel lock, which the entry stub keeps or releases once it switched stacks.
  * @param action the action to perform.
- * @param ctx the current PCB context.
+ * @param ctx the current PCB context, holding the request's arguments in EBX, ECX and EDX.
  * @return a pointer to the next context to load.
  * @author Andrew Bowie,  Zachary Ebert, Kolby Eisenhauer
  */
 struct context *sys_call(op_code action, struct context *ctx)
 {
-    if (first_context_ptr == NULL)
+    kernel_lock();
+
+    struct cpu *cpu = smp_this_cpu();
+    struct pcb *active_pcb_ptr = cpu->active;
+    if (cpu->first_context == NULL)
     {
-        first_context_ptr = ctx;
+        cpu->first_context = ctx;
     }
 
-    int ebx = 0, ecx = 0, edx = 0;
-    __asm__ volatile("mov %%ebx,%0" : "=r"(ebx));
-    __asm__ volatile("mov %%ecx,%0" : "=r"(ecx));
-    __asm__ volatile("mov %%edx,%0" : "=r"(edx));
+    //The entry stub saved the caller's registers before any C code could clobber them.
+    int ebx = ctx->ebx, ecx = ctx->ecx, edx = ctx->edx;
+
+    //The value returned to the caller by sys_req.
+    ctx->eax = 0;
 
     //Handle different actions in their own way.
-    struct pcb *next_to_load = get_next_pcb();
     switch (action)
     {
         case READ:
-        {
-            device dev = (device) ebx;
-            char *buffer = (char *) ecx;
-            size_t bytes = (size_t) edx;
-            io_req_result result = io_request(active_pcb_ptr, action, dev, buffer, bytes);
-
-            if (result == INVALID_PARAMS || result == SERVICED)
-                return next_pcb(next_to_load, ctx, READY);
-
-            //In this case, we need to move this device to a blocked state and CTX switch.
-            if (result == PARTIALLY_SERVICED || result == DEVICE_BUSY)
-            {
-                return next_pcb(next_to_load, ctx, BLOCKED);
-            }
-            return ctx;
-        }
         case WRITE:
+        case WRITEV:
         {
             device dev = (device) ebx;
             char *buffer = (char *) ecx;
             size_t bytes = (size_t) edx;
-            io_req_result result = io_request(active_pcb_ptr, action, dev, buffer, bytes);
+            size_t transferred = 0;
+            io_req_result result = io_request(active_pcb_ptr, action, dev, buffer, bytes, &transferred);
 
+            //Nothing to wait for, so the caller keeps running unless something else has to run first.
             if (result == INVALID_PARAMS || result == SERVICED)
             {
-                return next_pcb(next_to_load, ctx, READY);
+                ctx->eax = (int) transferred;
+                return resume_caller(ctx);
             }
 
             //In this case, we need to move this device to a blocked state and CTX switch.
             if (result == PARTIALLY_SERVICED || result == DEVICE_BUSY)
             {
-                return next_pcb(next_to_load, ctx, BLOCKED);
+                return next_pcb(next_or_idle(), ctx, BLOCKED);
             }
             return ctx;
         }
-        case IDLE:
+        case SEM_WAIT:
+        case SEM_SIGNAL:
+        case MUTEX_LOCK:
+        case MUTEX_UNLOCK:
+        case WQ_WAIT:
+        case WQ_NOTIFY:
+        case WQ_NOTIFY_ALL:
+        {
+            wait_queue_t *park_on = sync_request(action, (void *) ecx, (void *) edx, active_pcb_ptr, ctx);
+            if (park_on != NULL)
+                return park_pcb(next_or_idle(), ctx, park_on);
+            return resume_caller(ctx);
+        }
+        case MSG_SEND:
+        case MSG_RECEIVE:
+        case MSG_TRY_RECEIVE:
         {
-            return next_pcb(next_to_load, ctx, READY);
+            wait_queue_t *park_on = mailbox_request(action, (const char *) ecx, (message_t *) edx, active_pcb_ptr, ctx);
+            if (park_on != NULL)
+                return park_pcb(next_or_idle(), ctx, park_on);
+            return resume_caller(ctx);
+        }
+        case IO_RING_SETUP:
+        case IO_RING_ENTER:
+        {
+            wait_queue_t *park_on = io_ring_request(action, (io_ring_t *) ecx, (unsigned int) edx, active_pcb_ptr, ctx);
+            if (park_on != NULL)
+                return park_pcb(next_or_idle(), ctx, park_on);
+            return resume_caller(ctx);
+        }
+        case NOOP:
+            return resume_caller(ctx);
+        case SLEEP:
+        {
+            if (active_pcb_ptr == NULL || edx <= 0)
+                return ctx;
+            return park_pcb(next_or_idle(), ctx, sleep_request((unsigned int) edx, active_pcb_ptr));
+        }
+        case EDF_ADMIT:
+            ctx->eax = sched_edf_admit(active_pcb_ptr, (unsigned int) edx, (unsigned int) ecx);
+            return resume_caller(ctx);
+        case EDF_WAIT:
+        {
+            wait_queue_t *park_on = sched_edf_wait(active_pcb_ptr);
+            if (park_on != NULL)
+                return park_pcb(next_or_idle(), ctx, park_on);
+            return resume_caller(ctx);
         }
         case EXIT:
         {
@@ -149,15 +348,19 @@ struct context *sys_call(op_code action, struct context *ctx)
             if (exiting_pcb == NULL) //We can't exit if there's no PCB.
                 return ctx;
 
+            struct pcb *next_to_load = next_or_idle();
             pcb_remove(exiting_pcb);
             if (next_to_load == NULL) //No next process to load? Try loading the global one.
-                return first_context_ptr;
+                return cpu->first_context;
 
             //Free the old one.
             pcb_free(exiting_pcb);
             return next_pcb(next_to_load, NULL, 0);
         }
         default:
-            return next_pcb(next_to_load, ctx, READY);
+            //An application processor's first call has to dispatch something, if only its idle process.
+            if (active_pcb_ptr == NULL)
+                return next_pcb(next_or_idle(), ctx, READY);
+            return next_pcb(get_next_pcb(), ctx, READY);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,141 @@
+#include "mpx/timer.h"
+#include "mpx/io.h"
+#include "mpx/interrupts.h"
+#include "mpx/serial.h"
+#include "mpx/sys_call.h"
+#include "mpx/wait_queue.h"
+#include "mpx/intctl.h"
+#include "mpx/smp.h"
+
+/**
+ * @file timer.c
+ * @brief Drives the system tick from the PIT and keeps track of time spent idle.
+ */
+
+///The command port of the PIT.
+#define PIT_COMMAND 0x43
+///The data port of PIT channel 0.
+#define PIT_CHANNEL0 0x40
+///The input frequency of the PIT, in Hz.
+#define PIT_FREQUENCY 1193182
+///Channel 0, low then high byte, square wave mode.
+#define PIT_MODE_SQUARE 0x36
+///The interrupt vector the PIT's IRQ 0 is remapped to.
+#define TIMER_IV 0x20
+
+///The amount of ticks since the timer was initialized.
+static volatile unsigned int ticks = 0;
+///The time stamp when the timer was initialized.
+static unsigned long long boot_cycles = 0;
+///The total amount of cycles spent halted.
+static unsigned long long idle_cycles = 0;
+///The time stamp when the CPU was last halted.
+static unsigned long long halt_start = 0;
+///If the CPU is currently halted in cpu_idle.
+static volatile bool halted = false;
+
+///The sleeping PCBs, in no particular order.
+static wait_queue_t sleepers = {0};
+
+extern void timer_isr(void *);
+
+void timer_init(void)
+{
+    boot_cycles = rdtsc();
+    idt_install(TIMER_IV, timer_isr);
+
+    int divisor = PIT_FREQUENCY / TIMER_HZ;
+    cli();
+    outb(PIT_COMMAND, PIT_MODE_SQUARE);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
+
+    sti();
+    intctl_enable_irq(0);
+}
+
+unsigned int get_ticks(void)
+{
+    return ticks;
+}
+
+unsigned long long get_uptime_cycles(void)
+{
+    return rdtsc() - boot_cycles;
+}
+
+unsigned long long get_idle_cycles(void)
+{
+    return idle_cycles;
+}
+
+wait_queue_t *sleep_request(unsigned int ticks, struct pcb *caller)
+{
+    caller->wake_tick = get_ticks() + ticks;
+    return &sleepers;
+}
+
+void sleep_check(void)
+{
+    unsigned int now = get_ticks();
+    struct pcb *pcb_ptr = sleepers.head;
+    while(pcb_ptr != NULL)
+    {
+        struct pcb *next = pcb_ptr->wait_next;
+
+        //Compared as a difference so the tick count can wrap.
+        if((int) (now - pcb_ptr->wake_tick) >= 0)
+        {
+            wait_queue_unpark(pcb_ptr);
+            pcb_ptr->exec_state = READY;
+            pcb_insert(pcb_ptr);
+        }
+        pcb_ptr = next;
+    }
+}
+
+void idle_irq_entry(void)
+{
+    if(!halted)
+        return;
+
+    idle_cycles += rdtsc() - halt_start;
+    halted = false;
+}
+
+void cpu_idle(void)
+{
+    cli();
+    kernel_lock();
+    struct pcb *next = peek_next_pcb();
+    bool runnable = next != NULL && next->exec_state == READY && next->dispatch_state == NOT_SUSPENDED;
+    bool completion = io_completion_pending();
+    kernel_unlock();
+    if(runnable || completion)
+    {
+        sti();
+        return;
+    }
+
+    halt_start = rdtsc();
+    halted = true;
+
+    //STI only takes effect after the next instruction, so no interrupt can slip in before the HLT.
+    __asm__ volatile ("sti\n\thlt");
+    idle_irq_entry();
+}
+
+/**
+ * @brief The C half of the PIT interrupt handler.
+ * @param ctx the context of the interrupted process.
+ * @return the context to resume.
+ */
+struct context *timer_isr_intern(struct context *ctx)
+{
+    kernel_lock();
+    unsigned long long entered_at = rdtsc();
+    idle_irq_entry();
+    ticks++;
+    intctl_eoi(0, entered_at);
+    return irq_reschedule(ctx);
+}
@@ -0,0 +1,55 @@
+bits 16
+global ap_trampoline, ap_trampoline_end
+global ap_tramp_cr3, ap_tramp_stack, ap_tramp_entry
+
+;;; Application processor start up code. smp_init copies everything between
+;;; ap_trampoline and ap_trampoline_end to TRAMPOLINE_ADDR and fills in the
+;;; parameters, so every address here is relative to that copy.
+TRAMPOLINE_ADDR equ 0x8000
+%define REL(label) (TRAMPOLINE_ADDR + (label - ap_trampoline))
+
+section .text
+ap_trampoline:
+	cli
+	xor ax, ax
+	mov ds, ax
+	lgdt [REL(tramp_gdtr)]	; Flat segments, the same selectors as the kernel's GDT
+	mov eax, cr0
+	or eax, 1		; Protected mode
+	mov cr0, eax
+	jmp dword 0x08:REL(ap_protected)
+
+bits 32
+ap_protected:
+	mov ax, 0x10
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+	mov eax, [REL(ap_tramp_cr3)]	; Share the boot CPU's page directory
+	mov cr3, eax
+	mov eax, cr0
+	or eax, 0x80000000		; Paging
+	mov cr0, eax
+	mov esp, [REL(ap_tramp_stack)]
+	mov eax, [REL(ap_tramp_entry)]
+	call eax			; ap_main never returns
+.hang:
+	hlt
+	jmp .hang
+
+align 8
+tramp_gdt:
+	dq 0x0000000000000000	; NULL
+	dq 0x00CF9A000000FFFF	; CS
+	dq 0x00CF92000000FFFF	; DS
+tramp_gdt_end:
+tramp_gdtr:
+	dw tramp_gdt_end - tramp_gdt - 1
+	dd REL(tramp_gdt)
+
+ap_tramp_cr3:	dd 0	; The page directory to load
+ap_tramp_stack:	dd 0	; The top of the processor's stack
+ap_tramp_entry:	dd 0	; The C function to call
+ap_trampoline_end:
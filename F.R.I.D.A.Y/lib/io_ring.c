@@ -0,0 +1,41 @@
+#include "io_ring.h"
+
+int io_ring_setup(io_ring_t *ring)
+{
+    return sys_req(IO_RING_SETUP, ring);
+}
+
+bool io_ring_queue(io_ring_t *ring, op_code operation, device dev, char *buffer, size_t length, int user_data)
+{
+    unsigned int tail = ring->sq_tail;
+    if(tail - __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE) == IO_RING_ENTRIES)
+        return false;
+
+    io_sqe_t *sqe = &ring->sq[tail & (IO_RING_ENTRIES - 1)];
+    sqe->operation = operation;
+    sqe->dev = dev;
+    sqe->buffer = buffer;
+    sqe->length = length;
+    sqe->user_data = user_data;
+
+    //Publish the entry only once it's filled in.
+    __atomic_store_n(&ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+int io_ring_enter(io_ring_t *ring, unsigned int min_complete)
+{
+    return sys_req(IO_RING_ENTER, ring, min_complete);
+}
+
+bool io_ring_peek(io_ring_t *ring, io_cqe_t *cqe)
+{
+    //The entry is only read after the tail that published it.
+    unsigned int head = ring->cq_head;
+    if(head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE))
+        return false;
+
+    *cqe = ring->cq[head & (IO_RING_ENTRIES - 1)];
+    __atomic_store_n(&ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
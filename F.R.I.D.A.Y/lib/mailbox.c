@@ -0,0 +1,50 @@
+#include "mailbox.h"
+#include "memory.h"
+#include "string.h"
+#include "sys_req.h"
+
+message_t *msg_alloc(size_t length)
+{
+    message_t *msg = sys_alloc_mem(sizeof(message_t) + length);
+    if(msg == NULL)
+        return NULL;
+
+    msg->next = NULL;
+    msg->sender[0] = '\0';
+    msg->length = length;
+    return msg;
+}
+
+void msg_free(message_t *msg)
+{
+    if(msg != NULL)
+        sys_free_mem(msg);
+}
+
+int msg_send(const char *to, message_t *msg)
+{
+    return sys_req(MSG_SEND, to, msg);
+}
+
+int msg_send_copy(const char *to, const void *data, size_t length)
+{
+    message_t *msg = msg_alloc(length);
+    if(msg == NULL)
+        return INVALID_BUFFER;
+    memcpy(msg->data, data, length);
+
+    int result = msg_send(to, msg);
+    if(result != 0)
+        msg_free(msg);
+    return result;
+}
+
+message_t *msg_receive(void)
+{
+    return (message_t *) sys_req(MSG_RECEIVE);
+}
+
+message_t *msg_try_receive(void)
+{
+    return (message_t *) sys_req(MSG_TRY_RECEIVE);
+}
@@ -46,6 +46,25 @@ double pow(double a, double b)
     return 1;
 }
 
+unsigned int scale_ratio(unsigned long long part, unsigned long long whole, unsigned int scale)
+{
+    if(scale == 0)
+        return 0;
+
+    //Leave enough room for the multiplication by scale.
+    unsigned int limit = 0xFFFFFFFFu / scale;
+    while(whole > limit || part > limit)
+    {
+        part >>= 1;
+        whole >>= 1;
+    }
+
+    if(whole == 0)
+        return 0;
+
+    return (unsigned int) ((unsigned int) part * scale / (unsigned int) whole);
+}
+
 ///The LCRNG multiplier from C++.
 #define SEED_MULTI 25214903917L
 ///The LCRNG addend from C++.
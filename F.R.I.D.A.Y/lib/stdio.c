@@ -30,8 +30,9 @@ char getc(void)
 
 char pollc(void)
 {
-    int rc = sys_req(READ, COM1, NULL, 1);
-    return (char) rc;
+    char read = 0;
+    int rc = sys_req(READ, COM1, &read, 1);
+    return rc > 0 ? read : 0;
 }
 
 /**
@@ -132,17 +133,23 @@ void clearscr(void)
     print(reset_cursor);
 }
 
-void println(const char *s)
+void printv(const io_segment_t *segments, size_t count)
 {
-    size_t str_len = strlen(s);
-    char buffer[str_len + 2];
-    memset(buffer, 0, str_len + 2);
-    buffer[str_len] = '\n';
-    memcpy(buffer, s, str_len);
-    buffer[str_len + 1] = '\0';
+    sys_req(WRITEV, COM1, segments, count);
+}
 
+void println(const char *s)
+{
     if(FUNNY_MODE)
-        print_funny(buffer);
-    else
-        print(buffer);
+    {
+        print_funny(s);
+        print_funny("\n");
+        return;
+    }
+
+    io_segment_t line[2] = {
+            {s, strlen(s)},
+            {"\n", 1},
+    };
+    printv(line, 2);
 }
\ No newline at end of file
@@ -68,54 +68,164 @@ bool first_label_matches(const char *str1, const char *label)
     return strcicmp(str_token, label) == 0;
 }
 
-void *memcpy(void *restrict s1, const void *restrict s2, size_t n)
+///A word that may be unaligned, and may alias anything.
+typedef unsigned int __attribute__((aligned(1), may_alias)) unaligned_word;
+
+///Has a byte set to 0x01 in every byte.
+#define ONES 0x01010101u
+///Has a byte set to 0x80 in every byte.
+#define HIGHS 0x80808080u
+///Checks if any byte of the word is zero.
+#define HAS_ZERO_BYTE(word) (((word) - ONES) & ~(word) & HIGHS)
+
+/**
+ * @brief Copies the bytes backwards, for overlapping regions where the destination is after the source.
+ * @param dst the destination.
+ * @param src the source.
+ * @param n the amount of bytes.
+ */
+static void copy_backwards(unsigned char *dst, const unsigned char *src, size_t n)
 {
-    unsigned char *dst = s1;
-    const unsigned char *src = s2;
+    while (n-- > 0)
+        dst[n] = src[n];
+}
 
-    //Keep a temporary buffer to store the bytes.
-    //Doing this allows us to do 'in place' copies.
-    //i.e. An array {'a', 'b', 'c', '0'} copied to itself one step forward
-    //goes to {'a', 'a', 'b', 'c'}
-    unsigned char tmpbuf[n];
-    memset(tmpbuf, 0, n);
+/**
+ * @brief Checks if copying forwards would overwrite the source before it's read.
+ * @param dst the destination.
+ * @param src the source.
+ * @param n the amount of bytes.
+ * @return true if the copy has to go backwards.
+ */
+static bool overlaps_forward(const unsigned char *dst, const unsigned char *src, size_t n)
+{
+    return dst > src && dst < src + n;
+}
+
+/**
+ * @brief Copies a byte at a time.
+ * @param dst the destination.
+ * @param src the source.
+ * @param n the amount of bytes.
+ */
+static void memcpy_bytes(unsigned char *dst, const unsigned char *src, size_t n)
+{
     for (size_t i = 0; i < n; ++i)
-    {
-        tmpbuf[i] = src[i];
-    }
+        dst[i] = src[i];
+}
 
-    //Then copy from the temporary buffer.
-    for (size_t i = 0; i < n; i++)
-    {
-        dst[i] = tmpbuf[i];
-    }
-    return s1;
+/**
+ * @brief Copies a word at a time, then the leftover bytes.
+ * @param dst the destination.
+ * @param src the source.
+ * @param n the amount of bytes.
+ */
+static void memcpy_words(unsigned char *dst, const unsigned char *src, size_t n)
+{
+    size_t words = n / sizeof(unsigned int);
+    for (size_t i = 0; i < words; ++i)
+        ((unaligned_word *) dst)[i] = ((const unaligned_word *) src)[i];
+
+    size_t done = words * sizeof(unsigned int);
+    memcpy_bytes(dst + done, src + done, n - done);
 }
 
-void *memset(void *s, int c, size_t n)
+/**
+ * @brief Copies with REP MOVSB.
+ * @param dst the destination.
+ * @param src the source.
+ * @param n the amount of bytes.
+ */
+static void memcpy_rep(unsigned char *dst, const unsigned char *src, size_t n)
+{
+    __asm__ volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) :: "memory");
+}
+
+/**
+ * @brief Fills a byte at a time.
+ * @param dst the destination.
+ * @param c the byte.
+ * @param n the amount of bytes.
+ */
+static void memset_bytes(unsigned char *dst, unsigned char c, size_t n)
 {
-    unsigned char *p = s;
     for (size_t i = 0; i < n; i++)
+        dst[i] = c;
+}
+
+/**
+ * @brief Fills a word at a time, then the leftover bytes.
+ * @param dst the destination.
+ * @param c the byte.
+ * @param n the amount of bytes.
+ */
+static void memset_words(unsigned char *dst, unsigned char c, size_t n)
+{
+    unsigned int pattern = c * ONES;
+    size_t words = n / sizeof(unsigned int);
+    for (size_t i = 0; i < words; ++i)
+        ((unaligned_word *) dst)[i] = pattern;
+
+    size_t done = words * sizeof(unsigned int);
+    memset_bytes(dst + done, c, n - done);
+}
+
+/**
+ * @brief Fills with REP STOSB.
+ * @param dst the destination.
+ * @param c the byte.
+ * @param n the amount of bytes.
+ */
+static void memset_rep(unsigned char *dst, unsigned char c, size_t n)
+{
+    __asm__ volatile ("rep stosb" : "+D"(dst), "+c"(n) : "a"(c) : "memory");
+}
+
+/**
+ * @brief Measures a string a byte at a time.
+ * @param s the string.
+ * @return the length.
+ */
+static size_t strlen_bytes(const char *s)
+{
+    size_t len = 0;
+    while (*s++)
     {
-        p[i] = (unsigned char) c;
+        len++;
     }
-    return s;
+    return len;
 }
 
-char *strcpy(char *str_dest, const char *str_src, size_t maxlen)
+/**
+ * @brief Measures a string a word at a time once it's aligned. An aligned word never crosses
+ * a page, so reading past the terminator can't fault.
+ * @param s the string.
+ * @return the length.
+ */
+static size_t strlen_words(const char *s)
 {
-    if (str_dest == NULL || str_src == NULL)
-        return NULL;
+    const char *p = s;
+    for (; ((size_t) p & (sizeof(unsigned int) - 1)) != 0; ++p)
+    {
+        if (*p == '\0')
+            return p - s;
+    }
 
-    size_t src_len = strlen(str_src);
-    size_t copy_len = maxlen < src_len && maxlen > 0 ? maxlen : src_len;
+    const unaligned_word *w = (const unaligned_word *) p;
+    while (!HAS_ZERO_BYTE(*w))
+        w++;
 
-    //Copy the data.
-    memcpy(str_dest, str_src, copy_len + 1);
-    return str_dest;
+    for (p = (const char *) w; *p; ++p);
+    return p - s;
 }
 
-int strcmp(const char *s1, const char *s2)
+/**
+ * @brief Compares two strings a byte at a time.
+ * @param s1 the first string.
+ * @param s2 the second string.
+ * @return the difference of the first differing characters, or 0.
+ */
+static int strcmp_bytes(const char *s1, const char *s2)
 {
 
     // Remarks:
@@ -132,6 +242,116 @@ int strcmp(const char *s1, const char *s2)
     return (*(unsigned char *) s1 - *(unsigned char *) s2);
 }
 
+/**
+ * @brief Compares two strings a word at a time while they're equally aligned, finishing the
+ * word that differs or ends a byte at a time.
+ * @param s1 the first string.
+ * @param s2 the second string.
+ * @return the difference of the first differing characters, or 0.
+ */
+static int strcmp_words(const char *s1, const char *s2)
+{
+    const size_t mask = sizeof(unsigned int) - 1;
+    if (((size_t) s1 & mask) != ((size_t) s2 & mask))
+        return strcmp_bytes(s1, s2);
+
+    for (; ((size_t) s1 & mask) != 0; ++s1, ++s2)
+    {
+        if (*s1 == '\0' || *s1 != *s2)
+            return *(unsigned char *) s1 - *(unsigned char *) s2;
+    }
+
+    const unaligned_word *w1 = (const unaligned_word *) s1;
+    const unaligned_word *w2 = (const unaligned_word *) s2;
+    while (*w1 == *w2 && !HAS_ZERO_BYTE(*w1))
+    {
+        w1++;
+        w2++;
+    }
+    return strcmp_bytes((const char *) w1, (const char *) w2);
+}
+
+///The copy in use.
+static void (*memcpy_impl)(unsigned char *, const unsigned char *, size_t) = &memcpy_bytes;
+///The fill in use.
+static void (*memset_impl)(unsigned char *, unsigned char, size_t) = &memset_bytes;
+///The length in use.
+static size_t (*strlen_impl)(const char *) = &strlen_bytes;
+///The comparison in use.
+static int (*strcmp_impl)(const char *, const char *) = &strcmp_bytes;
+///The implementation in use.
+static enum string_impl current_impl = STRING_IMPL_BYTES;
+
+void string_set_impl(enum string_impl impl)
+{
+    current_impl = impl;
+    switch (impl)
+    {
+        case STRING_IMPL_REP:
+            memcpy_impl = &memcpy_rep;
+            memset_impl = &memset_rep;
+            strlen_impl = &strlen_words;
+            strcmp_impl = &strcmp_words;
+            break;
+        case STRING_IMPL_WORDS:
+            memcpy_impl = &memcpy_words;
+            memset_impl = &memset_words;
+            strlen_impl = &strlen_words;
+            strcmp_impl = &strcmp_words;
+            break;
+        default:
+            current_impl = STRING_IMPL_BYTES;
+            memcpy_impl = &memcpy_bytes;
+            memset_impl = &memset_bytes;
+            strlen_impl = &strlen_bytes;
+            strcmp_impl = &strcmp_bytes;
+            break;
+    }
+}
+
+enum string_impl string_get_impl(void)
+{
+    return current_impl;
+}
+
+void *memcpy(void *restrict s1, const void *restrict s2, size_t n)
+{
+    unsigned char *dst = s1;
+    const unsigned char *src = s2;
+
+    //Callers rely on 'in place' copies working, i.e. an array {'a', 'b', 'c', '0'} copied to
+    //itself one step forward goes to {'a', 'a', 'b', 'c'}, so those go backwards.
+    if (overlaps_forward(dst, src, n))
+        copy_backwards(dst, src, n);
+    else
+        memcpy_impl(dst, src, n);
+    return s1;
+}
+
+void *memset(void *s, int c, size_t n)
+{
+    memset_impl(s, (unsigned char) c, n);
+    return s;
+}
+
+char *strcpy(char *str_dest, const char *str_src, size_t maxlen)
+{
+    if (str_dest == NULL || str_src == NULL)
+        return NULL;
+
+    size_t src_len = strlen(str_src);
+    size_t copy_len = maxlen < src_len && maxlen > 0 ? maxlen : src_len;
+
+    //Copy the data.
+    memcpy(str_dest, str_src, copy_len + 1);
+    return str_dest;
+}
+
+int strcmp(const char *s1, const char *s2)
+{
+    return strcmp_impl(s1, s2);
+}
+
 int strcicmp(const char *s1, const char *s2)
 {
 
@@ -186,12 +406,7 @@ char *str_strip_whitespace(char *str, char *buffer, size_t buf_len)
 
 size_t strlen(const char *s)
 {
-    size_t len = 0;
-    while (*s++)
-    {
-        len++;
-    }
-    return len;
+    return strlen_impl(s);
 }
 
 char *str_to_upper(char *str, char *buffer, int buf_len)
@@ -0,0 +1,98 @@
+#include "spsc_ring.h"
+#include "memory.h"
+
+/**
+ * @file spsc_ring.c
+ * @brief The single producer, single consumer ring. Each side loads the other's index with acquire
+ * ordering and publishes its own with release ordering, so the bytes are always in place before
+ * the index that hands them over.
+ */
+
+bool spsc_init(spsc_ring_t *ring, size_t capacity)
+{
+    unsigned int size = 1;
+    while(size < capacity)
+        size <<= 1;
+
+    ring->buffer = sys_alloc_mem(size);
+    if(ring->buffer == NULL)
+    {
+        ring->mask = 0;
+        return false;
+    }
+
+    ring->mask = size - 1;
+    ring->head = ring->tail = 0;
+    return true;
+}
+
+void spsc_destroy(spsc_ring_t *ring)
+{
+    if(ring->buffer != NULL)
+        sys_free_mem(ring->buffer);
+
+    ring->buffer = NULL;
+    ring->mask = 0;
+    ring->head = ring->tail = 0;
+}
+
+size_t spsc_capacity(const spsc_ring_t *ring)
+{
+    return ring->buffer == NULL ? 0 : ring->mask + 1;
+}
+
+size_t spsc_count(const spsc_ring_t *ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+size_t spsc_space(const spsc_ring_t *ring)
+{
+    return spsc_capacity(ring) - spsc_count(ring);
+}
+
+bool spsc_push(spsc_ring_t *ring, char value)
+{
+    return spsc_write(ring, &value, 1) == 1;
+}
+
+bool spsc_pop(spsc_ring_t *ring, char *value)
+{
+    return spsc_read(ring, value, 1) == 1;
+}
+
+size_t spsc_write(spsc_ring_t *ring, const char *buffer, size_t len)
+{
+    if(ring->buffer == NULL)
+        return 0;
+
+    unsigned int head = ring->head;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t space = ring->mask + 1 - (head - tail);
+    if(len > space)
+        len = space;
+
+    for (size_t i = 0; i < len; ++i)
+        ring->buffer[(head + i) & ring->mask] = buffer[i];
+
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+    return len;
+}
+
+size_t spsc_read(spsc_ring_t *ring, char *buffer, size_t len)
+{
+    if(ring->buffer == NULL)
+        return 0;
+
+    unsigned int tail = ring->tail;
+    unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t count = head - tail;
+    if(len > count)
+        len = count;
+
+    for (size_t i = 0; i < len; ++i)
+        buffer[i] = ring->buffer[(tail + i) & ring->mask];
+
+    __atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+    return len;
+}
@@ -0,0 +1,61 @@
+#include "sync.h"
+#include "sys_req.h"
+#include "stddef.h"
+
+void wait_queue_init(wait_queue_t *wq)
+{
+    wq->head = wq->tail = NULL;
+}
+
+void sem_init(semaphore_t *sem, int count)
+{
+    sem->count = count;
+    wait_queue_init(&sem->waiters);
+}
+
+int sem_wait(semaphore_t *sem)
+{
+    return sys_req(SEM_WAIT, sem);
+}
+
+int sem_signal(semaphore_t *sem)
+{
+    return sys_req(SEM_SIGNAL, sem);
+}
+
+void mutex_init(mutex_t *mutex)
+{
+    mutex->owner = NULL;
+    mutex->next_held = NULL;
+    wait_queue_init(&mutex->waiters);
+}
+
+int mutex_lock(mutex_t *mutex)
+{
+    return sys_req(MUTEX_LOCK, mutex);
+}
+
+int mutex_unlock(mutex_t *mutex)
+{
+    return sys_req(MUTEX_UNLOCK, mutex);
+}
+
+int wq_wait(wait_queue_t *wq, mutex_t *mutex)
+{
+    int result = sys_req(WQ_WAIT, wq, mutex);
+    if(result != 0 || mutex == NULL)
+        return result;
+
+    //The kernel released the mutex while we were parked.
+    return mutex_lock(mutex);
+}
+
+int wq_notify(wait_queue_t *wq)
+{
+    return sys_req(WQ_NOTIFY, wq);
+}
+
+int wq_notify_all(wait_queue_t *wq)
+{
+    return sys_req(WQ_NOTIFY_ALL, wq);
+}
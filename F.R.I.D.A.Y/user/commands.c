@@ -15,6 +15,15 @@
 #include "mpx/alarm.h"
 #include "mpx/heap.h"
 #include "math.h"
+#include "mpx/timer.h"
+#include "mpx/serial.h"
+#include "mpx/sched.h"
+#include "mpx/intctl.h"
+#include "mpx/fpu.h"
+#include "io_ring.h"
+#include "mpx/cpuid.h"
+#include "ctype.h"
+#include "memory.h"
 
 #define CMD_HELP_LABEL "help"
 #define CMD_VERSION_LABEL "version"
@@ -38,6 +47,15 @@
 
 #define CMD_DRAGONMAZE "dragonmaze"
 #define CMD_MINESWEEPER "minesweeper"
+#define CMD_UPTIME "uptime"
+#define CMD_SYSBENCH "sysbench"
+#define CMD_TOP "top"
+#define CMD_SCHED "sched"
+#define CMD_IRQSTAT "irqstat"
+#define CMD_STRBENCH "strbench"
+#define CMD_UART "uart"
+#define CMD_SERIAL "serial"
+#define CMD_DEVSTAT "devstat"
 
 
 ///An array of all command labels, terminated with null.
@@ -60,6 +78,15 @@ static const char *CMD_LABELS[] = {
         CMD_SHOW_FREE,
         CMD_DRAGONMAZE,
         CMD_MINESWEEPER,
+        CMD_UPTIME,
+        CMD_SYSBENCH,
+        CMD_TOP,
+        CMD_SCHED,
+        CMD_IRQSTAT,
+        CMD_STRBENCH,
+        CMD_UART,
+        CMD_SERIAL,
+        CMD_DEVSTAT,
         NULL,
 };
 
@@ -419,6 +446,24 @@ struct help_info help_messages[] = {
             .help_message = "The '%s' Command will start up the dragonmaze game. Using W A S D you can manuver the character to try and save the princess, but beware of the dragon."},
         {.str_label = {CMD_MINESWEEPER},
             .help_message = "The '%s' Command will start up a fresh game of classic minesweeper. \nUsing W A S D to move, you can use the spacebar to blow up squares, and [f] to flag potential mines."},
+        {.str_label = {CMD_UPTIME},
+            .help_message = "The '%s' command shows how long the system has been running and how much of that time the CPU was busy.\nto see the uptime, enter 'uptime'"},
+        {.str_label = {CMD_SYSBENCH},
+            .help_message = "The '%s' command measures the cost of system requests, and of a burst of writes made one request at a time or batched through a ring, in CPU cycles.\nto run the benchmark, enter 'sysbench'"},
+        {.str_label = {CMD_TOP},
+            .help_message = "The '%s' command shows how much CPU time, IO and memory every process is using, refreshing every second until a key is pressed.\nto see the processes, enter 'top'"},
+        {.str_label = {CMD_SCHED},
+            .help_message = "Shows or changes the scheduling policy.\nEnter 'sched' to see the policy and its statistics.\nEnter 'sched priority' to schedule by the fixed priority of every process.\nEnter 'sched mlfq' to let user processes move between levels: burning whole quanta lowers them, waiting on IO raises them, and every second they're all reset.\nReal-time processes always run first, earliest deadline first, and their reserved CPU share and deadline misses are shown too.\nThe latency between an IO operation finishing and its process running is kept for each policy."},
+        {.str_label = {CMD_IRQSTAT},
+            .help_message = "Shows or changes the interrupt controller.\nEnter 'irqstat' to see the controller in use and the average cycles spent per interrupt under each one.\nEnter 'irqstat pic' to use the 8259 PIC and the PIT, or 'irqstat apic' to use the IO APIC and the local APIC timer."},
+        {.str_label = {CMD_STRBENCH},
+            .help_message = "The '%s' command times memcpy, memset, strlen and strcmp with each implementation: a byte at a time, a word at a time, and REP MOVSB/STOSB.\nThe one picked at boot from the CPU's features is used again afterwards."},
+        {.str_label = {CMD_UART},
+            .help_message = "Shows or changes how COM1 transmits.\nEnter 'uart' to see the UART found, its transmit FIFO, the interrupts and ISR cycles spent per kilobyte sent the receive threshold in use, and the bytes and time it takes to echo keystrokes.\nEnter 'uart fifo' to fill the transmit FIFO on every interrupt, or 'uart byte' to send a single byte per interrupt.\nEnter 'uart bench' to write a kilobyte under each and compare them."},
+        {.str_label = {CMD_SERIAL},
+            .help_message = "Shows or changes the serial ports' line settings.\nEnter 'serial' to see the baud rate and format of every port.\nEnter 'serial config <port> [baud] [format]' to change them, for example 'serial config com1 115200 8N1'. The baud rate can be up to 115200 and has to divide it, the format is the data bits, the parity (N, O, E, M or S) and the stop bits. Add 'rtscts', 'xonxoff' or 'noflow' to pick the flow control.\nEnter 'serial bench <port> [bytes]' to write to the port and measure the bytes per second that actually go out."},
+        {.str_label = {CMD_DEVSTAT},
+            .help_message = "Shows the traffic counters of every open serial port, to find where console slowness comes from.\nThey're the interrupts serviced by kind, the bytes in and out, bytes dropped on a full receive ring and lost to UART overruns, how full the rings have been, how many operations have queued for the port and how long processes were blocked on it.\nEnter 'devstat reset' to show them and then clear them."},
 
 };
 
@@ -507,6 +552,15 @@ bool cmd_help(const char *comm)
     println("=> enter 'help show-free");
     println("=> enter 'help dragonmaze'");
     println("=> enter 'help minesweeper'");
+    println("=> enter 'help uptime'");
+    println("=> enter 'help sysbench'");
+    println("=> enter 'help top'");
+    println("=> enter 'help sched'");
+    println("=> enter 'help irqstat'");
+    println("=> enter 'help strbench'");
+    println("=> enter 'help uart'");
+    println("=> enter 'help serial'");
+    println("=> enter 'help devstat'");
     return true;
 }
 
@@ -851,4 +905,719 @@ bool cmd_dragonmaze(const char *comm)
 
     start_dragonmaze_game();
     return true;
+}
+
+bool cmd_uptime(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_UPTIME))
+        return false;
+
+    unsigned int seconds = get_ticks() / TIMER_HZ;
+    unsigned int idle = scale_ratio(get_idle_cycles(), get_uptime_cycles(), 100);
+    printf("Up for %d:%02d:%02d\n", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    printf("CPU busy: %d%%, idle: %d%%\n", 100 - idle, idle);
+    return true;
+}
+
+///The amount of requests timed by 'sysbench' for each entry.
+#define SYSBENCH_ROUNDS 1000
+
+/**
+ * @brief Times a request through the given entry.
+ * @param op the request to make, without arguments.
+ * @param fast whether to use the fast entry or int $0x60.
+ * @return the average cycles per request.
+ */
+static unsigned int time_requests(op_code op, bool fast)
+{
+    sys_set_fast_entry(fast);
+    unsigned long long start = rdtsc();
+    for (int i = 0; i < SYSBENCH_ROUNDS; ++i)
+        sys_req(op);
+    unsigned long long cycles = rdtsc() - start;
+    sys_set_fast_entry(true);
+
+    return scale_ratio(cycles, SYSBENCH_ROUNDS, 1);
+}
+
+///The amount of writes 'sysbench' compares between single requests and a ring.
+#define SYSBENCH_WRITES 16
+
+/**
+ * @brief Times a burst of small writes to COM1, either as one request each or batched through a ring.
+ * @param batched true to queue them all in a ring and submit them with a single request.
+ * @return the cycles the whole burst took, until every write completed.
+ */
+static unsigned int time_writes(bool batched)
+{
+    //Registered for good, so it's never on a stack that goes away.
+    static io_ring_t ring;
+    static bool ring_ready = false;
+
+    unsigned long long start = rdtsc();
+    if (!batched)
+    {
+        for (int i = 0; i < SYSBENCH_WRITES; ++i)
+            sys_req(WRITE, COM1, ".", 1);
+        return (unsigned int) (rdtsc() - start);
+    }
+
+    if (!ring_ready)
+    {
+        if (io_ring_setup(&ring) != 0)
+            return 0;
+        ring_ready = true;
+    }
+
+    for (int i = 0; i < SYSBENCH_WRITES; ++i)
+        io_ring_queue(&ring, WRITE, COM1, ".", 1, i);
+    io_ring_enter(&ring, SYSBENCH_WRITES);
+    unsigned long long cycles = rdtsc() - start;
+
+    io_cqe_t cqe;
+    while (io_ring_peek(&ring, &cqe));
+    return (unsigned int) cycles;
+}
+
+bool cmd_sysbench(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_SYSBENCH))
+        return false;
+
+    printf("Null request, int $0x60: %d cycles\n", time_requests(NOOP, false));
+    printf("Null request, fast entry: %d cycles\n", time_requests(NOOP, true));
+    printf("Yield through the scheduler, int $0x60: %d cycles\n", time_requests(IDLE, false));
+    printf("Yield through the scheduler, fast entry: %d cycles\n", time_requests(IDLE, true));
+
+    unsigned int single = time_writes(false);
+    unsigned int batched = time_writes(true);
+    println("");
+    printf("%d one byte writes, a request each: %d cycles\n", SYSBENCH_WRITES, single);
+    printf("%d one byte writes, batched in a ring: %d cycles\n", SYSBENCH_WRITES, batched);
+    return true;
+}
+
+///The most PCBs 'top' displays.
+#define TOP_MAX_PCBS 32
+
+/**
+ * @brief Prints the text, then pads it with spaces to the given width.
+ * @param text the text.
+ * @param width the width of the column.
+ */
+static void print_column(const char *text, int width)
+{
+    char padded[width + 1];
+    int len = (int) strlen(text);
+    for (int i = 0; i < width; ++i)
+        padded[i] = i < len ? text[i] : ' ';
+    padded[width] = '\0';
+    print(padded);
+}
+
+/**
+ * @brief Prints the number, then pads it with spaces to the given width.
+ * @param num the number.
+ * @param width the width of the column.
+ */
+static void print_num_column(unsigned int num, int width)
+{
+    char buf[12] = {0};
+    sprintf("%d", buf, 12, num);
+    print_column(buf, width);
+}
+
+/**
+ * @brief Draws a single refresh of 'top'.
+ * @param interval the cycles since the last refresh.
+ */
+static void draw_top(unsigned long long interval)
+{
+    struct pcb *pcbs[TOP_MAX_PCBS];
+    size_t count = pcb_collect(pcbs, TOP_MAX_PCBS);
+    struct pcb *self = count > 0 ? pcbs[0] : NULL;
+    unsigned long long now = rdtsc();
+
+    unsigned int seconds = get_ticks() / TIMER_HZ;
+    unsigned int idle = scale_ratio(get_idle_cycles(), get_uptime_cycles(), 100);
+    clearscr();
+    printf("Up for %d:%02d:%02d, CPU busy: %d%%, FPU handoffs: %d, press any key to exit\n\n",
+           seconds / 3600, (seconds / 60) % 60, seconds % 60, 100 - idle, fpu_get_switches());
+    println("NAME      STATE    PRI CPU%  DISP   VOL    INVOL  READ    WRITTEN HEAP");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        struct pcb *pcb_ptr = pcbs[i];
+        unsigned long long cycles = pcb_ptr->stats.run_cycles;
+        if (pcb_ptr == self)
+            cycles += now - pcb_ptr->stats.dispatched_at;
+
+        print_column(pcb_ptr->name, 10);
+        print_column(get_exec_state_name(pcb_ptr->exec_state), 9);
+        print_num_column(sched_priority(pcb_ptr), 4);
+        print_num_column(scale_ratio(cycles - pcb_ptr->stats.sampled_cycles, interval, 100), 6);
+        print_num_column(pcb_ptr->stats.dispatches, 7);
+        print_num_column(pcb_ptr->stats.voluntary_switches, 7);
+        print_num_column(pcb_ptr->stats.involuntary_switches, 7);
+        print_num_column(pcb_ptr->stats.bytes_read, 8);
+        print_num_column(pcb_ptr->stats.bytes_written, 8);
+        print_num_column(pcb_ptr->stats.heap_bytes, 8);
+        println("");
+
+        pcb_ptr->stats.sampled_cycles = cycles;
+    }
+}
+
+bool cmd_top(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_TOP))
+        return false;
+
+    //The first refresh covers everything since boot.
+    unsigned long long last = rdtsc() - get_uptime_cycles();
+    struct pcb *pcbs[TOP_MAX_PCBS];
+    size_t count = pcb_collect(pcbs, TOP_MAX_PCBS);
+    for (size_t i = 0; i < count; ++i)
+        pcbs[i]->stats.sampled_cycles = 0;
+
+    while (serial_input_available(COM1) == 0)
+    {
+        unsigned long long now = rdtsc();
+        draw_top(now - last);
+        last = now;
+
+        sys_req(SLEEP, TIMER_HZ);
+    }
+
+    //Swallow the key that ended it.
+    getc();
+    return true;
+}
+
+///The names of the scheduling policies, by policy.
+static const char *policy_names[] = {"priority", "mlfq"};
+
+/**
+ * @brief Converts cycles to microseconds, using the cycles counted since boot.
+ * @param cycles the cycles.
+ * @return the microseconds.
+ */
+static unsigned int cycles_to_us(unsigned long long cycles)
+{
+    return scale_ratio(cycles, get_uptime_cycles(), get_ticks() * (1000000 / TIMER_HZ));
+}
+
+/**
+ * @brief Prints the IO wake up latency measured under the policy.
+ * @param policy the policy.
+ */
+static void print_latency(enum sched_policy policy)
+{
+    const struct sched_latency *lat = sched_get_latency(policy);
+    if (lat->count == 0)
+    {
+        printf("=> %s: no wake ups measured\n", policy_names[policy]);
+        return;
+    }
+
+    printf("=> %s: %d wake ups, %d us average, %d us worst\n", policy_names[policy], lat->count,
+           cycles_to_us(scale_ratio(lat->total_cycles, lat->count, 1)), cycles_to_us(lat->max_cycles));
+}
+
+bool cmd_sched(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_SCHED))
+        return false;
+
+    //Create a copy.
+    size_t str_len = strlen(comm);
+    char comm_cpy[str_len + 1];
+    memcpy(comm_cpy, comm, str_len + 1);
+
+    strtok(comm_cpy, " ");
+    char *policy_token = strtok(NULL, " ");
+    if (policy_token != NULL)
+    {
+        if (strcicmp(policy_token, policy_names[SCHED_PRIORITY]) == 0)
+            sched_set_policy(SCHED_PRIORITY);
+        else if (strcicmp(policy_token, policy_names[SCHED_MLFQ]) == 0)
+            sched_set_policy(SCHED_MLFQ);
+        else
+        {
+            printf("Unknown policy '%s', use 'priority' or 'mlfq'.\n", policy_token);
+            return true;
+        }
+    }
+
+    unsigned int demotions, boosts, resets;
+    sched_get_mlfq_stats(&demotions, &boosts, &resets);
+    printf("Scheduling policy: %s\n", policy_names[sched_get_policy()]);
+    printf("MLFQ demotions: %d, IO boosts: %d, resets: %d\n", demotions, boosts, resets);
+    unsigned int reserved = sched_edf_utilization();
+    printf("Real-time processes: %d.%d%% of the CPU reserved, %d deadline misses\n",
+           reserved / 10, reserved % 10, sched_edf_misses());
+    println("Latency from IO completion to dispatch:");
+    print_latency(SCHED_PRIORITY);
+    print_latency(SCHED_MLFQ);
+    return true;
+}
+
+///The names of the interrupt controllers, by mode.
+static const char *intctl_names[] = {"pic", "apic"};
+
+/**
+ * @brief Prints the interrupt timing measured under the mode.
+ * @param mode the mode.
+ */
+static void print_intctl_stats(enum intctl_mode mode)
+{
+    const struct intctl_stats *mode_stats = intctl_get_stats(mode);
+    if (mode_stats->count == 0)
+    {
+        printf("=> %s: no interrupts measured\n", intctl_names[mode]);
+        return;
+    }
+
+    printf("=> %s: %d interrupts, %d cycles in the handler, %d of them in the EOI\n", intctl_names[mode],
+           mode_stats->count, scale_ratio(mode_stats->handler_cycles, mode_stats->count, 1),
+           scale_ratio(mode_stats->eoi_cycles, mode_stats->count, 1));
+}
+
+bool cmd_irqstat(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_IRQSTAT))
+        return false;
+
+    //Create a copy.
+    size_t str_len = strlen(comm);
+    char comm_cpy[str_len + 1];
+    memcpy(comm_cpy, comm, str_len + 1);
+
+    strtok(comm_cpy, " ");
+    char *mode_token = strtok(NULL, " ");
+    if (mode_token != NULL)
+    {
+        if (strcicmp(mode_token, intctl_names[INTCTL_PIC]) == 0)
+            intctl_set_mode(INTCTL_PIC);
+        else if (strcicmp(mode_token, intctl_names[INTCTL_APIC]) == 0)
+        {
+            if (!intctl_set_mode(INTCTL_APIC))
+                println("No usable APIC was found at boot.");
+        }
+        else
+        {
+            printf("Unknown interrupt controller '%s', use 'pic' or 'apic'.\n", mode_token);
+            return true;
+        }
+    }
+
+    printf("Interrupt controller: %s\n", intctl_names[intctl_get_mode()]);
+    println("Average interrupt cost:");
+    print_intctl_stats(INTCTL_PIC);
+    print_intctl_stats(INTCTL_APIC);
+    return true;
+}
+
+///The rounds each string function is timed over.
+#define STRBENCH_ROUNDS 100
+///The size of the buffers the string functions are timed on.
+#define STRBENCH_SIZE 4096
+
+///The names of the string implementations, by implementation.
+static const char *string_impl_names[] = {"bytes", "words", "rep"};
+
+/**
+ * @brief Times the memory and string functions under an implementation.
+ * @param impl the implementation.
+ * @param src the buffer to copy from, holding a string that fills it.
+ * @param dst the buffer to copy to.
+ */
+static void time_string_impl(enum string_impl impl, char *src, char *dst)
+{
+    unsigned long long cycles[4] = {0};
+    string_set_impl(impl);
+    for (int i = 0; i < STRBENCH_ROUNDS; ++i)
+    {
+        unsigned long long start = rdtsc();
+        memcpy(dst, src, STRBENCH_SIZE);
+        unsigned long long copied = rdtsc();
+        memset(dst, 'a', STRBENCH_SIZE - 1);
+        unsigned long long filled = rdtsc();
+        strlen(src);
+        unsigned long long measured = rdtsc();
+        strcmp(src, dst);
+        unsigned long long compared = rdtsc();
+
+        cycles[0] += copied - start;
+        cycles[1] += filled - copied;
+        cycles[2] += measured - filled;
+        cycles[3] += compared - measured;
+    }
+
+    printf("%s: memcpy %d, memset %d, strlen %d, strcmp %d cycles\n", string_impl_names[impl],
+           scale_ratio(cycles[0], STRBENCH_ROUNDS, 1), scale_ratio(cycles[1], STRBENCH_ROUNDS, 1),
+           scale_ratio(cycles[2], STRBENCH_ROUNDS, 1), scale_ratio(cycles[3], STRBENCH_ROUNDS, 1));
+}
+
+bool cmd_strbench(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_STRBENCH))
+        return false;
+
+    static char src[STRBENCH_SIZE];
+    static char dst[STRBENCH_SIZE];
+    for (int i = 0; i < STRBENCH_SIZE - 1; ++i)
+        src[i] = 'a';
+    src[STRBENCH_SIZE - 1] = '\0';
+    dst[STRBENCH_SIZE - 1] = '\0';
+
+    enum string_impl selected = string_get_impl();
+    char features[96] = {0};
+    cpuid_describe(features, sizeof(features));
+    printf("%s, using '%s'\n", features, string_impl_names[selected]);
+    printf("Average over %d rounds of %d bytes:\n", STRBENCH_ROUNDS, STRBENCH_SIZE);
+    time_string_impl(STRING_IMPL_BYTES, src, dst);
+    time_string_impl(STRING_IMPL_WORDS, src, dst);
+    time_string_impl(STRING_IMPL_REP, src, dst);
+    string_set_impl(selected);
+    return true;
+}
+
+///The bytes written under each transmit mode by 'uart bench'.
+#define UART_BENCH_SIZE 1024
+
+/**
+ * @brief Prints the transmit counters of COM1 per kilobyte sent.
+ * @param label the label to print them with.
+ * @param stats the counters.
+ */
+static void print_tx_stats(const char *label, const struct serial_tx_stats *stats)
+{
+    if(stats->bytes == 0)
+    {
+        printf("=> %s: nothing transmitted\n", label);
+        return;
+    }
+
+    printf("=> %s: %d bytes, %d interrupts per KB, %d ISR cycles per KB\n", label, stats->bytes,
+           scale_ratio(stats->thre_interrupts, stats->bytes, 1024),
+           scale_ratio(stats->isr_cycles, stats->bytes, 1024));
+}
+
+/**
+ * @brief Writes a kilobyte to COM1 with the transmit FIFO filled or not, and reports the cost.
+ * @param fifo true to fill the FIFO per interrupt, false to send a byte per interrupt.
+ * @param block the kilobyte to write.
+ */
+static void bench_tx_mode(bool fifo, char *block)
+{
+    struct serial_tx_stats stats;
+    serial_set_tx_fifo(COM1, fifo);
+    serial_get_tx_stats(COM1, &stats, true);
+    sys_req(WRITE, COM1, block, UART_BENCH_SIZE);
+
+    //The write returns once it's in the transmit ring, so wait for the UART to take all of it.
+    while (serial_output_pending(COM1) > 0)
+        sys_req(IDLE);
+    serial_get_tx_stats(COM1, &stats, true);
+    print_tx_stats(fifo ? "fifo" : "byte", &stats);
+}
+
+bool cmd_uart(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_UART))
+        return false;
+
+    //Create a copy.
+    size_t str_len = strlen(comm);
+    char comm_cpy[str_len + 1];
+    memcpy(comm_cpy, comm, str_len + 1);
+
+    strtok(comm_cpy, " ");
+    char *mode_token = strtok(NULL, " ");
+    bool fifo = serial_get_tx_fifo(COM1);
+    if (mode_token != NULL && strcicmp(mode_token, "bench") == 0)
+    {
+        static char block[UART_BENCH_SIZE];
+        for (int i = 0; i < UART_BENCH_SIZE; ++i)
+            block[i] = (char) (i % 64 == 63 ? '\n' : 'a' + i % 26);
+
+        bench_tx_mode(false, block);
+        bench_tx_mode(true, block);
+        serial_set_tx_fifo(COM1, fifo);
+        return true;
+    }
+
+    if (mode_token != NULL)
+    {
+        if (strcicmp(mode_token, "fifo") == 0)
+            fifo = true;
+        else if (strcicmp(mode_token, "byte") == 0)
+            fifo = false;
+        else
+        {
+            printf("Unknown transmit mode '%s', use 'fifo', 'byte' or 'bench'.\n", mode_token);
+            return true;
+        }
+        serial_set_tx_fifo(COM1, fifo);
+    }
+
+    struct serial_tx_stats stats;
+    serial_get_tx_stats(COM1, &stats, mode_token != NULL);
+    printf("COM1: %s UART, %d byte transmit FIFO, filling %s per interrupt\n",
+           serial_uart_name(serial_get_uart(COM1)), serial_get_fifo_depth(COM1),
+           fifo ? "the FIFO" : "a byte");
+    print_tx_stats("since the last change", &stats);
+    printf("=> receiving: interrupting every %d bytes\n", serial_get_rx_trigger(COM1));
+
+    struct serial_echo_stats echo;
+    serial_get_echo_stats(COM1, &echo, mode_token != NULL);
+    if(echo.keystrokes > 0 && echo.latency_samples > 0)
+    {
+        printf("=> echo: %d keystrokes, %d bytes per 100 keystrokes, %d cycles average and %d at most to reach the UART\n",
+               echo.keystrokes, scale_ratio(echo.bytes, echo.keystrokes, 100),
+               scale_ratio(echo.latency_cycles, echo.latency_samples, 1), (unsigned int) echo.max_latency_cycles);
+    }
+    return true;
+}
+
+///The bytes 'serial bench' writes when no amount is given.
+#define SERIAL_BENCH_DEFAULT 4096
+///The most bytes 'serial bench' writes.
+#define SERIAL_BENCH_MAX 32768
+
+///The names of the ports, by serial_ports index.
+static const char *serial_port_names[] = {"com1", "com2", "com3", "com4"};
+///The ports the 'serial' command can use.
+static const device serial_ports[] = {COM1, COM2, COM3, COM4};
+
+/**
+ * @brief Finds the port with the given name.
+ * @param name the name, like 'com1'.
+ * @param dev where to put the port.
+ * @return true if it was found.
+ */
+static bool find_serial_port(const char *name, device *dev)
+{
+    for (size_t i = 0; name != NULL && i < sizeof(serial_ports) / sizeof(serial_ports[0]); ++i)
+    {
+        if (strcicmp(name, serial_port_names[i]) == 0)
+        {
+            *dev = serial_ports[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Prints the line settings of the port.
+ * @param index the port's serial_ports index.
+ */
+static void print_serial_config(size_t index)
+{
+    static const char *flow_names[] = {"no flow control", "RTS/CTS", "XON/XOFF"};
+
+    struct serial_config config;
+    serial_get_config(serial_ports[index], &config);
+    printf("%s: %d baud, %d%c%d, %s\n", serial_port_names[index], config.baud, config.data_bits,
+           config.parity - 'a' + 'A', config.stop_bits, flow_names[config.flow]);
+
+    struct serial_flow_stats stats;
+    serial_get_flow_stats(serial_ports[index], &stats, false);
+    printf("  %d dropped, %d overruns, throttled %d times, stopped %d times%s%s\n", stats.dropped,
+           stats.overruns, stats.throttles, stats.stops, stats.throttled ? ", throttled" : "",
+           stats.stopped ? ", stopped" : "");
+}
+
+/**
+ * @brief Handles 'serial config', changing the baud rate and format of a port.
+ * @param dev the port.
+ * @param index the port's serial_ports index.
+ */
+static void serial_config_command(device dev, size_t index)
+{
+    struct serial_config config;
+    serial_get_config(dev, &config);
+
+    //Each remaining token is a baud rate, a format like 8N1 or a flow control.
+    char *token;
+    while ((token = strtok(NULL, " ")) != NULL)
+    {
+        if (strcmp(token, "rtscts") == 0)
+            config.flow = SERIAL_FLOW_RTSCTS;
+        else if (strcmp(token, "xonxoff") == 0)
+            config.flow = SERIAL_FLOW_XONXOFF;
+        else if (strcmp(token, "noflow") == 0)
+            config.flow = SERIAL_FLOW_NONE;
+        else if (strlen(token) == 3 && !isdigit(token[1]))
+        {
+            config.data_bits = token[0] - '0';
+            config.parity = (char) (token[1] | 0x20);
+            config.stop_bits = token[2] - '0';
+        }
+        else
+        {
+            config.baud = atoi(token);
+        }
+    }
+
+    int result = serial_configure(dev, &config);
+    if (result == -102)
+        printf("The baud rate has to divide %d.\n", SERIAL_MAX_BAUD);
+    else if (result < 0)
+        println("Invalid format, use 5-8 data bits, N, O, E, M or S parity and 1-2 stop bits, like 8N1.");
+    print_serial_config(index);
+}
+
+/**
+ * @brief Handles 'serial bench', writing to a port and timing how fast it goes out.
+ * @param dev the port.
+ * @param index the port's serial_ports index.
+ */
+static void serial_bench_command(device dev, size_t index)
+{
+    char *amount_token = strtok(NULL, " ");
+    int amount = amount_token != NULL ? atoi(amount_token) : SERIAL_BENCH_DEFAULT;
+    if (amount <= 0 || amount > SERIAL_BENCH_MAX)
+    {
+        printf("The amount has to be from 1 to %d bytes.\n", SERIAL_BENCH_MAX);
+        return;
+    }
+
+    char *block = sys_alloc_mem(amount);
+    if (block == NULL)
+    {
+        println("Not enough memory for the benchmark.");
+        return;
+    }
+    for (int i = 0; i < amount; ++i)
+        block[i] = (char) (i % 64 == 63 ? '\n' : 'a' + i % 26);
+
+    //Start on a tick boundary, so the whole time is counted.
+    unsigned int start = get_ticks();
+    while (get_ticks() == start)
+        sys_req(IDLE);
+    start = get_ticks();
+
+    sys_req(WRITE, dev, block, amount);
+    while (serial_output_pending(dev) > 0)
+        sys_req(IDLE);
+    unsigned int ticks = get_ticks() - start;
+    sys_free_mem(block);
+
+    //A character is sent as a start bit, its data bits, a parity bit if there is one and its stop bits.
+    struct serial_config config;
+    serial_get_config(dev, &config);
+    int frame_bits = 1 + config.data_bits + (config.parity != 'n') + config.stop_bits;
+    unsigned int line_rate = (unsigned int) (config.baud / frame_bits);
+    unsigned int achieved = ticks == 0 ? (unsigned int) amount * TIMER_HZ
+                                       : scale_ratio((unsigned int) amount, ticks, TIMER_HZ);
+
+    print_serial_config(index);
+    printf("=> %d bytes in %d ticks: %d bytes/sec of a %d bytes/sec line rate (%d%%)\n", amount, ticks,
+           achieved, line_rate, scale_ratio(achieved, line_rate, 100));
+}
+
+bool cmd_serial(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_SERIAL))
+        return false;
+
+    //Create a copy.
+    size_t str_len = strlen(comm);
+    char comm_cpy[str_len + 1];
+    memcpy(comm_cpy, comm, str_len + 1);
+
+    strtok(comm_cpy, " ");
+    char *action = strtok(NULL, " ");
+    if (action == NULL)
+    {
+        for (size_t i = 0; i < sizeof(serial_ports) / sizeof(serial_ports[0]); ++i)
+            print_serial_config(i);
+        return true;
+    }
+
+    char *port_name = strtok(NULL, " ");
+    device dev;
+    if (!find_serial_port(port_name, &dev))
+    {
+        println("Enter a port to use, from com1 to com4.");
+        return true;
+    }
+    size_t index = 0;
+    while (serial_ports[index] != dev)
+        index++;
+
+    if (strcicmp(action, "config") == 0)
+        serial_config_command(dev, index);
+    else if (strcicmp(action, "bench") == 0)
+        serial_bench_command(dev, index);
+    else
+        printf("Unknown action '%s', use 'config' or 'bench'.\n", action);
+    return true;
+}
+
+///The names of the interrupt kinds, by serial_irq_kind.
+static const char *serial_irq_names[] = {"modem", "transmit", "receive", "line", "timeout"};
+
+/**
+ * @brief Prints the traffic counters of an open port.
+ * @param index the port's serial_ports index.
+ * @param reset true to clear the counters after printing them.
+ */
+static void print_dev_stats(size_t index, bool reset)
+{
+    struct serial_dev_stats stats;
+    struct serial_flow_stats flow;
+    if (!serial_get_dev_stats(serial_ports[index], &stats, reset))
+        return;
+    serial_get_flow_stats(serial_ports[index], &flow, reset);
+
+    unsigned int interrupts = 0;
+    for (int i = 0; i < SERIAL_IRQ_KINDS; ++i)
+        interrupts += stats.interrupts[i];
+
+    printf("%s: %d interrupts:", serial_port_names[index], interrupts);
+    for (int i = 0; i < SERIAL_IRQ_KINDS; ++i)
+        printf(" %d %s%c", stats.interrupts[i], serial_irq_names[i], i + 1 < SERIAL_IRQ_KINDS ? ',' : '\n');
+
+    printf("  %d bytes in, %d bytes out, %d dropped, %d overruns\n", stats.bytes_in, stats.bytes_out,
+           flow.dropped, flow.overruns);
+    printf("  rings at most %d/%d receive and %d/%d transmit\n", stats.rx_high_water, stats.rx_capacity,
+           stats.tx_high_water, stats.tx_capacity);
+    printf("  %d operations waiting, %d at most\n", stats.queue_depth, stats.max_queue_depth);
+    if (stats.blocked_waits == 0)
+    {
+        println("  no process blocked");
+        return;
+    }
+    printf("  processes blocked %d times, %d us average, %d us worst\n", stats.blocked_waits,
+           cycles_to_us(scale_ratio(stats.blocked_cycles, stats.blocked_waits, 1)), cycles_to_us(stats.max_blocked_cycles));
+}
+
+bool cmd_devstat(const char *comm)
+{
+    if(!first_label_matches(comm, CMD_DEVSTAT))
+        return false;
+
+    //Create a copy.
+    size_t str_len = strlen(comm);
+    char comm_cpy[str_len + 1];
+    memcpy(comm_cpy, comm, str_len + 1);
+
+    strtok(comm_cpy, " ");
+    char *action = strtok(NULL, " ");
+    bool reset = action != NULL && strcicmp(action, "reset") == 0;
+    if (action != NULL && !reset)
+    {
+        printf("Unknown action '%s', use 'reset' or nothing.\n", action);
+        return true;
+    }
+
+    for (size_t i = 0; i < sizeof(serial_ports) / sizeof(serial_ports[0]); ++i)
+        print_dev_stats(i, reset);
+    if (reset)
+        println("The counters were reset.");
+    return true;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "bomb_catcher.h"
 #include "stdio.h"
 #include "stdbool.h"
+#include "cli.h"
 
 ///The width of the game screen
 #define SCREEN_WIDTH 30
@@ -21,6 +22,9 @@ static int time = 0;
 ///The position of the catcher.
 static int catcher_pos = 0;
 
+///A full row of spaces, shared by every segment that needs blank space.
+static const char blank_row[SCREEN_WIDTH + 1] = "                              ";
+
 ///Stalls CPU time by spinning on a for loop.
 void stall(void)
 {
@@ -39,26 +43,24 @@ void reset(void)
 void draw_scr(void)
 {
     clearscr();
+
+    //Every row is the same, so the whole screen is one write.
+    io_segment_t screen[SCREEN_HEIGHT * 3];
     for (int i = 0; i < SCREEN_HEIGHT; ++i)
     {
-        print("|");
-        for (int j = 0; j < SCREEN_WIDTH; ++j)
-        {
-            print(" ");
-        }
-        print("|\n");
+        screen[i * 3] = (io_segment_t) {"|", 1};
+        screen[i * 3 + 1] = (io_segment_t) {blank_row, SCREEN_WIDTH};
+        screen[i * 3 + 2] = (io_segment_t) {"|\n", 2};
     }
+    printv(screen, SCREEN_HEIGHT * 3);
 
     //Print the catcher.
-    for (int i = 0; i < catcher_pos; ++i)
-    {
-        print(" ");
-    }
-    print("\\-/");
-    for (int i = 0; i < SCREEN_WIDTH - catcher_pos; ++i)
-    {
-        print(" ");
-    }
+    io_segment_t catcher[3] = {
+            {blank_row, catcher_pos},
+            {"\\-/", 3},
+            {blank_row, SCREEN_WIDTH - catcher_pos},
+    };
+    printv(catcher, 3);
 }
 
 ///'ticks' the game.
@@ -77,8 +79,11 @@ void start_bombcatcher(void)
     reset();
     game_active = true;
 
+    //Keys are polled every tick, so reads can't wait for them.
+    set_raw_input(true, true);
     while(game_active) {
         stall();
         game_tick();
     }
+    set_raw_input(false, false);
 }
@@ -12,6 +12,7 @@
 #include "mpx/heap.h"
 #include "string.h"
 #include "print_format.h"
+#include "cli.h"
 
 #define EMPTY ' '
 #define FOUR_WAY_WALL '+'
@@ -737,8 +738,9 @@ void start_dragonmaze_game(void)
 
     print_board();
 
-    //Begin the game loop.
+    //Begin the game loop, moves are single keys so they don't need editing or an enter.
     running = true;
+    set_raw_input(true, false);
     while(running)
     {
         move_hero();
@@ -748,6 +750,7 @@ void start_dragonmaze_game(void)
 
         print_board();
     }
+    set_raw_input(false, false);
 
     //Do a final cleanup.
     ll_clear(inform_list);
@@ -11,6 +11,7 @@
 #include "print_format.h"
 #include "stdlib.h"
 #include "linked_list.h"
+#include "cli.h"
 
 #define MINE_WIDTH 40
 #define MINE_HEIGHT 10
@@ -330,11 +331,15 @@ void start_minesweeper_game(unsigned long long game_seed)
     pc_x = pc_y = mines = mines_flagged = free_squares = revealed_squares = 0;
     generate_mines(game_seed);
     print_mine();
+
+    //Moves are single keys, so they don't need editing or an enter.
+    set_raw_input(true, false);
     while(game_running)
     {
         ms_game_tick();
         print_mine();
     }
+    set_raw_input(false, false);
     memset(revealed_map, 1, sizeof (revealed_map));
     pc_x = pc_y = -1;
     print_mine();
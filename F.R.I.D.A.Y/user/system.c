@@ -13,6 +13,7 @@
 #include <memory.h>
 #include <processes.h>
 #include <sys_req.h>
+#include <mpx/timer.h>
 
 /* For R3: How many times each process prints its message */
 #define RC_1 1
@@ -25,6 +26,12 @@
 static char dispatched[] = " dispatched\r\n";
 static char after_exit[] = " ran after it was terminated!\r\n";
 
+/* The system call handler, also entered directly by the fast entry. */
+extern void sys_call_isr(void);
+
+/* Whether sys_req uses the fast entry instead of int $0x60. */
+static bool fast_entry_enabled = true;
+
 /* For R5: Pointers to student provided functions */
 /* DO NOT SET MANUALLY, CALL sys_set_heap_functions() !!! */
 static void * (*malloc_function)(size_t) = NULL;
@@ -39,17 +46,52 @@ int sys_req(op_code op, ...)
 	char *buffer = NULL;
 	size_t len = 0;
 
-	if (op == READ || op == WRITE) {
+	if (op == READ || op == WRITE || op == WRITEV) {
+		/* For WRITEV the buffer is the segment array, and the length the segment count. */
 		va_list ap;
 		va_start(ap, op);
 		dev = va_arg(ap, device);
 		buffer = va_arg(ap, char *);
 		len = va_arg(ap, size_t);
 		va_end(ap);
+	} else if (op >= SEM_WAIT && op <= IO_RING_ENTER) {
+		/* The object goes in ECX, and a second argument in EDX. */
+		va_list ap;
+		va_start(ap, op);
+		if (op != MSG_RECEIVE && op != MSG_TRY_RECEIVE)
+			buffer = (char *) va_arg(ap, void *);
+		if (op == WQ_WAIT || op == MSG_SEND)
+			len = (size_t) va_arg(ap, void *);
+		else if (op == IO_RING_ENTER)
+			len = va_arg(ap, unsigned int);
+		va_end(ap);
+	} else if (op == SLEEP || op == EDF_ADMIT) {
+		/* The ticks, or the period, go in EDX and the budget in ECX. */
+		va_list ap;
+		va_start(ap, op);
+		len = va_arg(ap, unsigned int);
+		if (op == EDF_ADMIT)
+			buffer = (char *) (size_t) va_arg(ap, unsigned int);
+		va_end(ap);
 	}
 
 	int ret = 0;
-	__asm__ volatile("int $0x60" : "=a"(ret) : "a"(op), "b"(dev), "c"(buffer), "d"(len));
+	if (fast_entry_enabled) {
+		/* Push the EFLAGS, CS and EIP an interrupt would, then call the handler directly.
+		 * This skips the IDT lookup and gate checks, and its iret pops the frame again. */
+		__asm__ volatile("pushfl\n\tcli\n\tpushl %%cs\n\tcall sys_call_isr"
+				 : "=a"(ret) : "a"(op), "b"(dev), "c"(buffer), "d"(len) : "memory", "cc");
+	} else {
+		__asm__ volatile("int $0x60" : "=a"(ret) : "a"(op), "b"(dev), "c"(buffer), "d"(len));
+	}
+
+	if (ret == -1 && op == WRITEV) {
+		const io_segment_t *segments = (const io_segment_t *) buffer;
+		int written = 0;
+		for (size_t i = 0; i < len; i++)
+			written += serial_out(dev, segments[i].base, segments[i].length);
+		return written;
+	}
 
 	if (ret == -1 && (op == READ || op == WRITE)) {
 		return (op == READ)
@@ -60,6 +102,11 @@ int sys_req(op_code op, ...)
 	return ret;
 }
 
+void sys_set_fast_entry(bool enabled)
+{
+	fast_entry_enabled = enabled;
+}
+
 /***********************************************************************/
 /* This causes R5 to go into full effect, replacing default heap functions
  * with those implemented by students. */
@@ -85,13 +132,12 @@ int sys_free_mem(void *ptr)
 /***********************************************************************/
 /* The Idle process */
 /* You must create a System process of lowest priority for this in R3. */
+/* Halts the CPU until an interrupt whenever nothing else is ready. */
 /***********************************************************************/
 void sys_idle_process(void)
 {
-//	char msg[] = "IDLE PROCESS EXECUTING.\r\n";
-	
 	for (;;) {
-//		sys_req(WRITE, COM1, msg, sizeof(msg));
+		cpu_idle();
 		sys_req(IDLE);
 	}
 }